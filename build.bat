@@ -4,8 +4,12 @@ SET GAME_NAME="Juelsminde Joust"
 
 SET CFLAGS=-std=c99 -O3 -Wall -Wextra -pedantic -I include
 
-SET LDFLAGS=-L lib -lraylib -lopengl32 -lgdi32 -lwinmm
+SET LDFLAGS=-L lib -lraylib -lopengl32 -lgdi32 -lwinmm -lpthread
 
-gcc %CFLAGS% -o %GAME_NAME% main.c %LDFLAGS%
+gcc %CFLAGS% -c jj_sim.c -o jj_sim.o
+if %errorlevel% neq 0 exit /b %errorlevel%
+ar rcs libjj_sim.a jj_sim.o
+
+gcc %CFLAGS% -o %GAME_NAME% main.c -L . -ljj_sim %LDFLAGS%
 
 if %errorlevel%==0  %GAME_NAME%
\ No newline at end of file
@@ -12,11 +12,82 @@ esac
 
 game_name="Juelsminde Joust"
 
+# NOTE(jakob): The simulation is built on its own as libjj_sim, which needs no
+# window, audio or GL. "./build.sh headless" only builds it and jj_headless,
+# for machines without a display.
+if [ "$1" == 'headless' ]; then
+	cc -std=c99 -O2 -Wall -Wextra -pedantic -c jj_sim.c -o jj_sim.o
+	ar rcs libjj_sim.a jj_sim.o
+	cc -std=c99 -O2 -Wall -Wextra -pedantic -o jj_headless jj_headless.c -L. -ljj_sim -lm -lpthread
+	exit 0
+fi
+
+# NOTE(jakob): "./build.sh check" builds jj_headless and runs its self-check,
+# which fails if any bullet kernel this CPU supports differs from the scalar
+# one or the spawn directions or arcs drift too far
+if [ "$1" == 'check' ]; then
+	./build.sh headless
+	./jj_headless --selfcheck
+	exit $?
+fi
+
+# NOTE(jakob): "./build.sh bench" builds jj_headless and runs the benchmark
+# cases quoted in the change log, so their figures can be reproduced. Every
+# case runs on one thread; timings on a busy machine need paired runs.
+if [ "$1" == 'bench' ]; then
+	./build.sh headless
+
+	# Sweep-and-prune player contacts at 4, 32 and 256 players. Players have
+	# 1000 health, so the lobby stays full. JJ_SIM_GENERIC=1 keeps 4 player
+	# lobbies on the sweep instead of their written-out pair tests.
+	for players in 4 32 256; do
+		JJ_SIM_GENERIC=1 ./jj_headless $players 1500 1 1000 3
+	done
+
+	# Tick time against player count in all-bot lobbies
+	for players in 4 8 16 32 64 128 256; do
+		./jj_headless $players 1500 1 1000 3
+	done
+
+	# About 8k live bullets in an 8 player match, with annihilation and
+	# without; the difference is the annihilation pass
+	for annihilation in 1 0; do
+		JJ_HEADLESS_MIN_BULLETS=8192 ./jj_headless 8 3000 1 1000000 7 $annihilation
+	done
+
+	# The 10x10 screen benchmark arena, next to a 1 screen one
+	for players in 4 64 256; do
+		for screens in 1 10; do
+			./jj_headless $players 10000 1 2 12345 0 $screens
+		done
+	done
+
+	# The written-out pair and opponent tests of 2 to 4 player lobbies, next
+	# to the generic sweep and grid tests on the same matches
+	for players in 2 3 4; do
+		./jj_headless $players 100000 1 5 3
+		JJ_SIM_GENERIC=1 ./jj_headless $players 100000 1 5 3
+	done
+
+	# Bullets stepped once every 1, 2 and 4 ticks, with and without obstacles
+	for obstacles in - resources/obstacles.txt; do
+		for divisor in 1 2 4; do
+			./jj_headless 256 1500 1 1000 3 0 1 $obstacles $divisor
+		done
+	done
+
+	exit 0
+fi
+
 if [ $machine == 'Mac' ]; then
-	cc main.c -std=c99 -Os -Wall -Wextra -pedantic -framework IOKit -framework Cocoa -framework OpenGL -I/usr/local/Cellar/raylib/3.7.0/include -L/usr/local/Cellar/raylib/3.7.0/lib -lraylib -o "$game_name"
+	cc -std=c99 -Os -Wall -Wextra -pedantic -c jj_sim.c -o jj_sim.o
+	ar rcs libjj_sim.a jj_sim.o
+	cc main.c -std=c99 -Os -Wall -Wextra -pedantic -framework IOKit -framework Cocoa -framework OpenGL -I/usr/local/Cellar/raylib/3.7.0/include -L. -ljj_sim -L/usr/local/Cellar/raylib/3.7.0/lib -lraylib -o "$game_name"
 elif [ $machine == 'Linux' ]; then
-	# gcc -std=c99 -O0 -ggdb -Wall -Wextra -pedantic -ftabstop=1 -o "$game_name" main.c -lraylib -lGL -lm -ldl -lrt -lX11
-	gcc -std=c99 -O0 -ggdb -Wall -Wextra -pedantic -ftabstop=1 -o "$game_name" main.c -lraylib -lGL -lm -ldl -lrt -lX11
+	gcc -std=c99 -O0 -ggdb -Wall -Wextra -pedantic -ftabstop=1 -c jj_sim.c -o jj_sim.o
+	ar rcs libjj_sim.a jj_sim.o
+	# gcc -std=c99 -O0 -ggdb -Wall -Wextra -pedantic -ftabstop=1 -o "$game_name" main.c -lraylib -lGL -lm -lpthread -ldl -lrt -lX11
+	gcc -std=c99 -O0 -ggdb -Wall -Wextra -pedantic -ftabstop=1 -o "$game_name" main.c -L. -ljj_sim -lraylib -lGL -lm -lpthread -ldl -lrt -lX11
 fi
 
 "./$game_name"
\ No newline at end of file
@@ -0,0 +1,576 @@
+#include "jj_bullets.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define JJ_X86_SIMD 1
+#include <immintrin.h>
+#else
+#define JJ_X86_SIMD 0
+#endif
+
+// NOTE(jakob): Sine and cosine of a binary angle in float. The angle is
+// folded into [0, PI/4] with integer operations, where these polynomials are
+// accurate to float precision, and the octant then swaps and negates the
+// results bitwise. There are no branches or table lookups, so the vector
+// variants evaluate the exact same operations in the same order, which keeps
+// every variant bit-identical to the scalar path.
+#define SIN_C3 (-1.0f/6.0f)
+#define SIN_C5 (1.0f/120.0f)
+#define SIN_C7 (-1.0f/5040.0f)
+#define SIN_C9 (1.0f/362880.0f)
+#define COS_C2 (-1.0f/2.0f)
+#define COS_C4 (1.0f/24.0f)
+#define COS_C6 (-1.0f/720.0f)
+#define COS_C8 (1.0f/40320.0f)
+#define COS_C10 (-1.0f/3628800.0f)
+
+#define ARC_OCTANT (1u << 29)
+#define ARC_QUARTER (1u << 30)
+#define ARC_SIGN (1u << 31)
+
+// Closed form against a double precision integration over BULLET_ARC_CHECK_TICKS
+#define BULLET_ARC_CHECK_TICKS 700
+#define BULLET_ARC_MAX_ERROR 0.01f
+#define BULLET_DIRECTION_MAX_ERROR 1e-6f
+#define BULLET_DIRECTION_CHECK_MAX_COUNT 2048
+
+static void arc_sin_cos(Binary_Angle angle, float *sin_out, float *cos_out) {
+	// All ones in the odd octants, where the angle is measured back from the next one
+	uint32_t reflect = (uint32_t)((int32_t)(angle << 2) >> 31);
+	uint32_t fraction = ((angle & (ARC_OCTANT - 1)) ^ reflect) - reflect + (reflect & ARC_OCTANT);
+
+	float x = (float)(int32_t)fraction*RADIANS_PER_BINARY_ANGLE;
+	float x2 = x*x;
+	float s = x*(1.0f + x2*(SIN_C3 + x2*(SIN_C5 + x2*(SIN_C7 + x2*SIN_C9))));
+	float c = 1.0f + x2*(COS_C2 + x2*(COS_C4 + x2*(COS_C6 + x2*(COS_C8 + x2*COS_C10))));
+
+	uint32_t s_bits, c_bits;
+	memcpy(&s_bits, &s, sizeof(s));
+	memcpy(&c_bits, &c, sizeof(c));
+
+	// Sine and cosine trade places in the octants next to PI/2 and 3*PI/2
+	uint32_t swap = (uint32_t)((int32_t)((angle + ARC_OCTANT) << 1) >> 31);
+	uint32_t exchange = (s_bits ^ c_bits) & swap;
+
+	s_bits ^= exchange ^ (angle & ARC_SIGN);
+	c_bits ^= exchange ^ ((angle + ARC_QUARTER) & ARC_SIGN);
+
+	memcpy(sin_out, &s_bits, sizeof(s_bits));
+	memcpy(cos_out, &c_bits, sizeof(c_bits));
+}
+
+// NOTE(jakob): The volley's arc after (tick - spawn_tick) steps, the same for
+// every lane: dt times the sum of the step rotations so far, and the rotation
+// of all steps together
+typedef struct Bullet_Arc_Factors {
+	float sum_c;
+	float sum_s;
+	float rotate_c;
+	float rotate_s;
+} Bullet_Arc_Factors;
+
+static Bullet_Arc_Factors bullet_arc_factors(const Bullet_Volley *volley, uint32_t tick) {
+	uint32_t steps = tick - volley->spawn_tick;
+
+	float sin_a, cos_a, sin_b, cos_b;
+	arc_sin_cos((steps - 1)*volley->half_turn, &sin_a, &cos_a);
+	arc_sin_cos(steps*volley->half_turn, &sin_b, &cos_b);
+
+	float sum_scale = sin_b*volley->arc_scale;
+
+	Bullet_Arc_Factors arc;
+	arc.sum_c = sum_scale*cos_a;
+	arc.sum_s = sum_scale*sin_a;
+	arc.rotate_c = cos_b*cos_b - sin_b*sin_b;
+	arc.rotate_s = 2.0f*cos_b*sin_b;
+
+	return arc;
+}
+
+static void bullet_arc_range(const Bullet_Volley *volley, Bullet_Arc_Factors arc, int first_lane, int begin, int end, Bullet_Arc_States states_out) {
+	for (int i = begin; i < end; ++i) {
+		float direction_s, direction_c;
+		arc_sin_cos(volley->start_angle + (uint32_t)(first_lane + i)*volley->angle_step, &direction_s, &direction_c);
+
+		float vx = direction_c*volley->speed + volley->base_vx;
+		float vy = direction_s*volley->speed + volley->base_vy;
+
+		states_out.x[i] = volley->x + (vx*arc.sum_c - vy*arc.sum_s);
+		states_out.y[i] = volley->y + (vx*arc.sum_s + vy*arc.sum_c);
+		states_out.vx[i] = vx*arc.rotate_c - vy*arc.rotate_s;
+		states_out.vy[i] = vx*arc.rotate_s + vy*arc.rotate_c;
+	}
+}
+
+void bullet_arc_scalar(const Bullet_Volley *volley, int first_lane, int lane_count, uint32_t tick, Bullet_Arc_States states_out) {
+	bullet_arc_range(volley, bullet_arc_factors(volley, tick), first_lane, 0, lane_count, states_out);
+}
+
+void bullet_arc_from_spin(float spin, float dt, Binary_Angle *half_turn_out, float *arc_scale_out) {
+	Binary_Angle half_turn = binary_angle_from_radians(0.5f*spin*dt);
+	if (half_turn == 0) half_turn = 1;
+
+	float sin_half, cos_half;
+	arc_sin_cos(half_turn, &sin_half, &cos_half);
+
+	*half_turn_out = half_turn;
+	*arc_scale_out = dt/sin_half;
+}
+
+#if JJ_X86_SIMD
+
+// NOTE(jakob): One body for all widths; VEC, VECI, LANE_INDICES, SET1, SET1I,
+// STORE, ADD, SUB, MUL, ADDI, SUBI, MULLOI, ANDI, XORI, SLLI, SRAI, CVTI, F2I
+// and I2F are defined per instruction set right before each expansion. Only
+// integer logic is used on the float bits, since AVX-512F has no float and/xor.
+#define BULLET_ARC_SIMD_SIN_COS(ANGLE, SIN_OUT, COS_OUT) do { \
+	VECI angle_ = (ANGLE); \
+	VECI reflect_ = SRAI(SLLI(angle_, 2), 31); \
+	VECI fraction_ = ADDI(SUBI(XORI(ANDI(angle_, octant_mask), reflect_), reflect_), ANDI(reflect_, octant)); \
+	VEC x_ = MUL(CVTI(fraction_), radians); \
+	VEC x2_ = MUL(x_, x_); \
+	VEC s_ = MUL(x_, ADD(one, MUL(x2_, ADD(s3, MUL(x2_, ADD(s5, MUL(x2_, ADD(s7, MUL(x2_, s9))))))))); \
+	VEC c_ = ADD(one, MUL(x2_, ADD(c2, MUL(x2_, ADD(c4, MUL(x2_, ADD(c6, MUL(x2_, ADD(c8, MUL(x2_, c10)))))))))); \
+	VECI swap_ = SRAI(SLLI(ADDI(angle_, octant), 1), 31); \
+	VECI exchange_ = ANDI(XORI(F2I(s_), F2I(c_)), swap_); \
+	SIN_OUT = I2F(XORI(F2I(s_), XORI(exchange_, ANDI(angle_, sign)))); \
+	COS_OUT = I2F(XORI(F2I(c_), XORI(exchange_, ANDI(ADDI(angle_, quarter), sign)))); \
+} while (0)
+
+// NOTE(jakob): The arc factors are computed by the caller and the last
+// partial vector is computed whole into a temporary, so the vector code never
+// calls scalar code compiled without VEX. Switching between the two with dirty
+// upper registers costs hundreds of nanoseconds per call on some CPUs, more
+// than evaluating a small volley.
+#define BULLET_ARC_SIMD_BODY(LANES) \
+	VECI octant = SET1I((int)ARC_OCTANT), octant_mask = SET1I((int)(ARC_OCTANT - 1)); \
+	VECI quarter = SET1I((int)ARC_QUARTER), sign = SET1I((int)ARC_SIGN); \
+	VEC radians = SET1(RADIANS_PER_BINARY_ANGLE); \
+	VEC s3 = SET1(SIN_C3), s5 = SET1(SIN_C5), s7 = SET1(SIN_C7), s9 = SET1(SIN_C9); \
+	VEC c2 = SET1(COS_C2), c4 = SET1(COS_C4), c6 = SET1(COS_C6), c8 = SET1(COS_C8), c10 = SET1(COS_C10); \
+	VEC one = SET1(1.0f); \
+	VECI start_angle = SET1I((int)volley->start_angle), angle_step = SET1I((int)volley->angle_step); \
+	VECI lane = ADDI(SET1I(first_lane), LANE_INDICES), lane_stride = SET1I(LANES); \
+	VEC speed = SET1(volley->speed), base_vx = SET1(volley->base_vx), base_vy = SET1(volley->base_vy); \
+	VEC origin_x = SET1(volley->x), origin_y = SET1(volley->y); \
+	VEC sum_c = SET1(arc.sum_c), sum_s = SET1(arc.sum_s); \
+	VEC rotate_c = SET1(arc.rotate_c), rotate_s = SET1(arc.rotate_s); \
+	for (int i = 0; i < lane_count; i += (LANES)) { \
+		VEC direction_s, direction_c; \
+		BULLET_ARC_SIMD_SIN_COS(ADDI(start_angle, MULLOI(lane, angle_step)), direction_s, direction_c); \
+		lane = ADDI(lane, lane_stride); \
+		VEC vx = ADD(MUL(direction_c, speed), base_vx); \
+		VEC vy = ADD(MUL(direction_s, speed), base_vy); \
+		VEC x = ADD(origin_x, SUB(MUL(vx, sum_c), MUL(vy, sum_s))); \
+		VEC y = ADD(origin_y, ADD(MUL(vx, sum_s), MUL(vy, sum_c))); \
+		VEC rotated_vx = SUB(MUL(vx, rotate_c), MUL(vy, rotate_s)); \
+		VEC rotated_vy = ADD(MUL(vx, rotate_s), MUL(vy, rotate_c)); \
+		if (i + (LANES) <= lane_count) { \
+			STORE(states_out.x + i, x); \
+			STORE(states_out.y + i, y); \
+			STORE(states_out.vx + i, rotated_vx); \
+			STORE(states_out.vy + i, rotated_vy); \
+		} else { \
+			float tail[4][LANES]; \
+			STORE(tail[0], x); \
+			STORE(tail[1], y); \
+			STORE(tail[2], rotated_vx); \
+			STORE(tail[3], rotated_vy); \
+			for (int tail_index = 0; i + tail_index < lane_count; ++tail_index) { \
+				states_out.x[i + tail_index] = tail[0][tail_index]; \
+				states_out.y[i + tail_index] = tail[1][tail_index]; \
+				states_out.vx[i + tail_index] = tail[2][tail_index]; \
+				states_out.vy[i + tail_index] = tail[3][tail_index]; \
+			} \
+		} \
+	}
+
+// NOTE(jakob): SSE2 has no 32-bit low multiply. It is built from two
+// 32x32->64 multiplies of the even and odd lanes, whose low halves are the
+// same bits _mm_mullo_epi32 gives.
+__attribute__((target("sse2")))
+static inline __m128i arc_mullo_epi32_sse2(__m128i a, __m128i b) {
+	__m128i even = _mm_mul_epu32(a, b);
+	__m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+	return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+#define VEC __m128
+#define VECI __m128i
+#define SET1 _mm_set1_ps
+#define SET1I _mm_set1_epi32
+#define LANE_INDICES _mm_setr_epi32(0, 1, 2, 3)
+#define STORE _mm_storeu_ps
+#define ADD _mm_add_ps
+#define SUB _mm_sub_ps
+#define MUL _mm_mul_ps
+#define ADDI _mm_add_epi32
+#define SUBI _mm_sub_epi32
+#define MULLOI arc_mullo_epi32_sse2
+#define ANDI _mm_and_si128
+#define XORI _mm_xor_si128
+#define SLLI _mm_slli_epi32
+#define SRAI _mm_srai_epi32
+#define CVTI _mm_cvtepi32_ps
+#define F2I _mm_castps_si128
+#define I2F _mm_castsi128_ps
+__attribute__((target("sse2")))
+static void bullet_arc_lanes_sse2(const Bullet_Volley *volley, Bullet_Arc_Factors arc, int first_lane, int lane_count, Bullet_Arc_States states_out) {
+	BULLET_ARC_SIMD_BODY(4)
+}
+#undef MULLOI
+#define MULLOI _mm_mullo_epi32
+__attribute__((target("sse4.1")))
+static void bullet_arc_lanes_sse41(const Bullet_Volley *volley, Bullet_Arc_Factors arc, int first_lane, int lane_count, Bullet_Arc_States states_out) {
+	BULLET_ARC_SIMD_BODY(4)
+}
+#undef VEC
+#undef VECI
+#undef SET1
+#undef SET1I
+#undef LANE_INDICES
+#undef STORE
+#undef ADD
+#undef SUB
+#undef MUL
+#undef ADDI
+#undef SUBI
+#undef MULLOI
+#undef ANDI
+#undef XORI
+#undef SLLI
+#undef SRAI
+#undef CVTI
+#undef F2I
+#undef I2F
+
+#define VEC __m256
+#define VECI __m256i
+#define SET1 _mm256_set1_ps
+#define SET1I _mm256_set1_epi32
+#define LANE_INDICES _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7)
+#define STORE _mm256_storeu_ps
+#define ADD _mm256_add_ps
+#define SUB _mm256_sub_ps
+#define MUL _mm256_mul_ps
+#define ADDI _mm256_add_epi32
+#define SUBI _mm256_sub_epi32
+#define MULLOI _mm256_mullo_epi32
+#define ANDI _mm256_and_si256
+#define XORI _mm256_xor_si256
+#define SLLI _mm256_slli_epi32
+#define SRAI _mm256_srai_epi32
+#define CVTI _mm256_cvtepi32_ps
+#define F2I _mm256_castps_si256
+#define I2F _mm256_castsi256_ps
+__attribute__((target("avx2")))
+static void bullet_arc_lanes_avx2(const Bullet_Volley *volley, Bullet_Arc_Factors arc, int first_lane, int lane_count, Bullet_Arc_States states_out) {
+	BULLET_ARC_SIMD_BODY(8)
+}
+#undef VEC
+#undef VECI
+#undef SET1
+#undef SET1I
+#undef LANE_INDICES
+#undef STORE
+#undef ADD
+#undef SUB
+#undef MUL
+#undef ADDI
+#undef SUBI
+#undef MULLOI
+#undef ANDI
+#undef XORI
+#undef SLLI
+#undef SRAI
+#undef CVTI
+#undef F2I
+#undef I2F
+
+#define VEC __m512
+#define VECI __m512i
+#define SET1 _mm512_set1_ps
+#define SET1I _mm512_set1_epi32
+#define LANE_INDICES _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15)
+#define STORE _mm512_storeu_ps
+#define ADD _mm512_add_ps
+#define SUB _mm512_sub_ps
+#define MUL _mm512_mul_ps
+#define ADDI _mm512_add_epi32
+#define SUBI _mm512_sub_epi32
+#define MULLOI _mm512_mullo_epi32
+#define ANDI _mm512_and_si512
+#define XORI _mm512_xor_si512
+#define SLLI _mm512_slli_epi32
+#define SRAI _mm512_srai_epi32
+#define CVTI _mm512_cvtepi32_ps
+#define F2I _mm512_castps_si512
+#define I2F _mm512_castsi512_ps
+__attribute__((target("avx512f")))
+static void bullet_arc_lanes_avx512(const Bullet_Volley *volley, Bullet_Arc_Factors arc, int first_lane, int lane_count, Bullet_Arc_States states_out) {
+	BULLET_ARC_SIMD_BODY(16)
+}
+#undef VEC
+#undef VECI
+#undef SET1
+#undef SET1I
+#undef LANE_INDICES
+#undef STORE
+#undef ADD
+#undef SUB
+#undef MUL
+#undef ADDI
+#undef SUBI
+#undef MULLOI
+#undef ANDI
+#undef XORI
+#undef SLLI
+#undef SRAI
+#undef CVTI
+#undef F2I
+#undef I2F
+
+// NOTE(jakob): Smaller fans are cheaper to evaluate on the scalar path than to
+// set up the vector constants for; the results are the same either way
+#define BULLET_ARC_MIN_VECTOR_LANES 4
+
+static void bullet_arc_sse2(const Bullet_Volley *volley, int first_lane, int lane_count, uint32_t tick, Bullet_Arc_States states_out) {
+	Bullet_Arc_Factors arc = bullet_arc_factors(volley, tick);
+	if (lane_count < BULLET_ARC_MIN_VECTOR_LANES) {
+		bullet_arc_range(volley, arc, first_lane, 0, lane_count, states_out);
+	} else {
+		bullet_arc_lanes_sse2(volley, arc, first_lane, lane_count, states_out);
+	}
+}
+
+static void bullet_arc_sse41(const Bullet_Volley *volley, int first_lane, int lane_count, uint32_t tick, Bullet_Arc_States states_out) {
+	Bullet_Arc_Factors arc = bullet_arc_factors(volley, tick);
+	if (lane_count < BULLET_ARC_MIN_VECTOR_LANES) {
+		bullet_arc_range(volley, arc, first_lane, 0, lane_count, states_out);
+	} else {
+		bullet_arc_lanes_sse41(volley, arc, first_lane, lane_count, states_out);
+	}
+}
+
+static void bullet_arc_avx2(const Bullet_Volley *volley, int first_lane, int lane_count, uint32_t tick, Bullet_Arc_States states_out) {
+	Bullet_Arc_Factors arc = bullet_arc_factors(volley, tick);
+	if (lane_count < BULLET_ARC_MIN_VECTOR_LANES) {
+		bullet_arc_range(volley, arc, first_lane, 0, lane_count, states_out);
+	} else {
+		bullet_arc_lanes_avx2(volley, arc, first_lane, lane_count, states_out);
+	}
+}
+
+static void bullet_arc_avx512(const Bullet_Volley *volley, int first_lane, int lane_count, uint32_t tick, Bullet_Arc_States states_out) {
+	Bullet_Arc_Factors arc = bullet_arc_factors(volley, tick);
+	if (lane_count < BULLET_ARC_MIN_VECTOR_LANES) {
+		bullet_arc_range(volley, arc, first_lane, 0, lane_count, states_out);
+	} else {
+		bullet_arc_lanes_avx512(volley, arc, first_lane, lane_count, states_out);
+	}
+}
+
+#endif // JJ_X86_SIMD
+
+static Bullet_Arc_Variant bullet_arc_variants[] = {
+	{"scalar", bullet_arc_scalar, 1, true},
+#if JJ_X86_SIMD
+	{"sse2", bullet_arc_sse2, 4, false},
+	{"sse4.1", bullet_arc_sse41, 4, false},
+	{"avx2", bullet_arc_avx2, 8, false},
+	{"avx512", bullet_arc_avx512, 16, false},
+#endif
+};
+
+#define BULLET_ARC_VARIANT_COUNT (int)(sizeof(bullet_arc_variants)/sizeof(bullet_arc_variants[0]))
+
+static int bullet_arc_selected_variant = 0;
+
+void bullet_kernels_init(void) {
+#if JJ_X86_SIMD
+	__builtin_cpu_init();
+	bullet_arc_variants[1].supported = __builtin_cpu_supports("sse2");
+	bullet_arc_variants[2].supported = __builtin_cpu_supports("sse4.1");
+	bullet_arc_variants[3].supported = __builtin_cpu_supports("avx2");
+	bullet_arc_variants[4].supported = __builtin_cpu_supports("avx512f");
+#endif
+
+	for (int variant_index = 0; variant_index < BULLET_ARC_VARIANT_COUNT; ++variant_index) {
+		if (bullet_arc_variants[variant_index].supported) {
+			bullet_arc_selected_variant = variant_index;
+		}
+	}
+}
+
+Bullet_Arc_Kernel bullet_arc_kernel(void) {
+	return bullet_arc_variants[bullet_arc_selected_variant].kernel;
+}
+
+const char *bullet_arc_kernel_name(void) {
+	return bullet_arc_variants[bullet_arc_selected_variant].name;
+}
+
+static float bullet_check_random_01(uint32_t *lcg) {
+	*lcg = *lcg*1664525u + 1013904223u;
+	return (float)(*lcg >> 8) / (float)(1 << 24);
+}
+
+bool bullet_kernels_self_check(float dt, Bullet_Kernels_Report *report_out) {
+	enum { CHECK_VOLLEYS = 24, CHECK_LANES = 333, CHECK_STEPPED_LANES = 8, CHECK_CHUNK = 64 };
+	static Bullet_Volley volleys[CHECK_VOLLEYS];
+	static float reference[4][CHECK_LANES];
+	static float candidate[4][CHECK_LANES];
+
+	uint32_t lcg = 12345u;
+
+	// NOTE(jakob): Odd lane counts, so every variant also runs its scalar tail
+	for (int volley_index = 0; volley_index < CHECK_VOLLEYS; ++volley_index) {
+		Bullet_Volley *volley = &volleys[volley_index];
+		volley->x = 1440.0f*bullet_check_random_01(&lcg);
+		volley->y = 900.0f*bullet_check_random_01(&lcg);
+		volley->base_vx = 550.0f*(bullet_check_random_01(&lcg) - 0.5f);
+		volley->base_vy = 550.0f*(bullet_check_random_01(&lcg) - 0.5f);
+		volley->speed = 1000.0f*bullet_check_random_01(&lcg);
+		volley->count = (1 + (int)((CHECK_LANES - 1)*bullet_check_random_01(&lcg))) | 1;
+		volley->start_angle = lcg;
+		volley->angle_step = binary_angle_from_radians((volley_index & 1 ? 0.6f : 6.2831853f)/(float)volley->count);
+		volley->spawn_tick = lcg % 800u;
+		volley->owner = volley_index;
+
+		float spin = 12.0f*(bullet_check_random_01(&lcg) - 0.5f);
+		bullet_arc_from_spin(volley_index % 7 ? spin : 0.0f, dt, &volley->half_turn, &volley->arc_scale);
+	}
+
+	Bullet_Arc_States reference_states = {reference[0], reference[1], reference[2], reference[3]};
+
+	// Before, at and long after the spawn ticks, and with the tick count wrapped
+	uint32_t ticks[] = {3u, 400u, 1500u, 0xFFFFFFF0u};
+	bool variant_matches[BULLET_ARC_MAX_VARIANTS];
+	assert(BULLET_ARC_VARIANT_COUNT <= BULLET_ARC_MAX_VARIANTS);
+
+	for (int variant_index = 0; variant_index < BULLET_ARC_VARIANT_COUNT; ++variant_index) {
+		variant_matches[variant_index] = bullet_arc_variants[variant_index].supported;
+	}
+
+	for (int tick_index = 0; tick_index < (int)(sizeof(ticks)/sizeof(ticks[0])); ++tick_index) {
+		for (int volley_index = 0; volley_index < CHECK_VOLLEYS; ++volley_index) {
+			Bullet_Volley *volley = &volleys[volley_index];
+			bullet_arc_scalar(volley, 0, volley->count, ticks[tick_index], reference_states);
+
+			// NOTE(jakob): Every variant, the scalar one too, evaluates the
+			// volley in chunks starting at non-zero lanes, like the bullet update
+			for (int variant_index = 0; variant_index < BULLET_ARC_VARIANT_COUNT; ++variant_index) {
+				Bullet_Arc_Variant *variant = &bullet_arc_variants[variant_index];
+				if (!variant->supported) continue;
+
+				for (int first_lane = 0; first_lane < volley->count; first_lane += CHECK_CHUNK) {
+					Bullet_Arc_States chunk = {
+						candidate[0] + first_lane, candidate[1] + first_lane,
+						candidate[2] + first_lane, candidate[3] + first_lane,
+					};
+					int lane_count = volley->count - first_lane < CHECK_CHUNK ? volley->count - first_lane : CHECK_CHUNK;
+					variant->kernel(volley, first_lane, lane_count, ticks[tick_index], chunk);
+				}
+
+				bool match = true;
+				for (int state_index = 0; state_index < 4; ++state_index) {
+					match = match && memcmp(candidate[state_index], reference[state_index], volley->count*sizeof(float)) == 0;
+				}
+
+				if (!match && variant_matches[variant_index]) {
+					fprintf(stderr, "Bullet arc kernel '%s' differs from the scalar path\n", variant->name);
+				}
+				variant_matches[variant_index] = variant_matches[variant_index] && match;
+			}
+		}
+	}
+
+	bool all_match = true;
+
+	for (int variant_index = 0; variant_index < BULLET_ARC_VARIANT_COUNT; ++variant_index) {
+		if (bullet_arc_variants[variant_index].supported) {
+			all_match = all_match && variant_matches[variant_index];
+		}
+	}
+
+	// NOTE(jakob): The spawn directions against libm in double precision, for
+	// rings and fans of 1 to 2047 bullets. Every lane evaluates its own binary
+	// angle, so the error does not build up along the volley the way adding
+	// up the angles or rotating from lane to lane would.
+	double max_direction_error = 0.0;
+
+	for (int count = 1; count <= BULLET_DIRECTION_CHECK_MAX_COUNT; count = 2*count + 1) {
+		for (int ring = 0; ring < 2; ++ring) {
+			lcg = lcg*1664525u + 1013904223u;
+			Binary_Angle start_angle = lcg;
+			Binary_Angle angle_step = binary_angle_from_radians((ring ? 6.2831853f : 0.6f)/(float)count);
+
+			for (int lane = 0; lane < count; ++lane) {
+				Binary_Angle angle = start_angle + (uint32_t)lane*angle_step;
+
+				float direction_s, direction_c;
+				arc_sin_cos(angle, &direction_s, &direction_c);
+
+				double radians = (double)angle*(double)RADIANS_PER_BINARY_ANGLE;
+				double error = fmax(fabs((double)direction_s - sin(radians)), fabs((double)direction_c - cos(radians)));
+				if (error > max_direction_error) max_direction_error = error;
+			}
+		}
+	}
+
+	if (max_direction_error > BULLET_DIRECTION_MAX_ERROR) {
+		fprintf(stderr, "Bullet spawn directions are off by %g from libm\n", max_direction_error);
+	}
+
+	if (report_out) {
+		report_out->max_direction_error = (float)max_direction_error;
+		report_out->variant_count = BULLET_ARC_VARIANT_COUNT;
+		for (int variant_index = 0; variant_index < BULLET_ARC_VARIANT_COUNT; ++variant_index) {
+			report_out->variants[variant_index] = bullet_arc_variants[variant_index];
+			report_out->variant_matches[variant_index] = variant_matches[variant_index];
+		}
+	}
+
+	// NOTE(jakob): Steps the first lanes the way the simulation used to, in
+	// double precision, and compares against the closed form at every tick
+	double max_error = 0.0;
+
+	for (int volley_index = 0; volley_index < CHECK_VOLLEYS; ++volley_index) {
+		Bullet_Volley *volley = &volleys[volley_index];
+		double turn = 2.0*(double)(int32_t)volley->half_turn*(double)RADIANS_PER_BINARY_ANGLE;
+		double turn_c = cos(turn), turn_s = sin(turn);
+
+		for (int lane = 0; lane < volley->count && lane < CHECK_STEPPED_LANES; ++lane) {
+			double direction = (double)(volley->start_angle + (uint32_t)lane*volley->angle_step)*(double)RADIANS_PER_BINARY_ANGLE;
+			double x = volley->x, y = volley->y;
+			double vx = cos(direction)*volley->speed + volley->base_vx;
+			double vy = sin(direction)*volley->speed + volley->base_vy;
+
+			for (int step = 1; step <= BULLET_ARC_CHECK_TICKS; ++step) {
+				x += vx*(double)dt;
+				y += vy*(double)dt;
+
+				double next_vx = vx*turn_c - vy*turn_s;
+				vy = vx*turn_s + vy*turn_c;
+				vx = next_vx;
+
+				float state_x, state_y, state_vx, state_vy;
+				Bullet_Arc_States state = {&state_x, &state_y, &state_vx, &state_vy};
+				bullet_arc_scalar(volley, lane, 1, volley->spawn_tick + (uint32_t)step, state);
+
+				double error = fmax(fabs((double)state_x - x), fabs((double)state_y - y));
+				error = fmax(error, dt*fmax(fabs((double)state_vx - vx), fabs((double)state_vy - vy)));
+				if (error > max_error) max_error = error;
+			}
+		}
+	}
+
+	if (max_error > BULLET_ARC_MAX_ERROR) {
+		fprintf(stderr, "Bullet arcs drift %g from stepping them\n", max_error);
+	}
+
+	if (report_out) {
+		report_out->max_arc_error = (float)max_error;
+	}
+
+	return all_match && max_direction_error <= BULLET_DIRECTION_MAX_ERROR && max_error <= BULLET_ARC_MAX_ERROR;
+}
@@ -0,0 +1,86 @@
+#ifndef JJ_BULLETS_H
+#define JJ_BULLETS_H
+
+// NOTE(jakob): All bullets of one volley leave the same origin on the same
+// tick with the same speed, spin and base velocity, in evenly spaced
+// directions, so a volley is stored as one record and its bullets are lanes
+// 0 to count - 1 of it. Lane i leaves in direction start_angle + i*angle_step.
+//
+// A bullet keeps its speed and turns its velocity by the same angle every
+// tick, so it moves along a circular arc (a very wide one when it does not
+// spin). Its position and velocity at any tick are evaluated in closed form:
+//
+//   position(k) = start + dt*velocity_start*sum(e^(i*n*turn), n < k)
+//               = start + velocity_start*e^(i*(k - 1)*half_turn)*sin(k*half_turn)*dt/sin(half_turn)
+//   velocity(k) = velocity_start*e^(i*2*k*half_turn)
+//
+// The angles are binary angles, so k*half_turn and i*angle_step wrap around
+// exactly. The arc factors are the same for every lane of a volley.
+typedef struct Bullet_Volley {
+	float x; // Origin
+	float y;
+	float base_vx; // Added to every lane's velocity
+	float base_vy;
+	float speed;
+	Binary_Angle start_angle;
+	Binary_Angle angle_step;
+	Binary_Angle half_turn; // Half the turn per tick, never zero; from bullet_arc_from_spin
+	float arc_scale; // dt/sin(half_turn)
+	uint32_t spawn_tick; // The first step tick
+	int owner;
+	int count;
+} Bullet_Volley;
+
+typedef struct Bullet_Arc_States {
+	float *x;
+	float *y;
+	float *vx;
+	float *vy;
+} Bullet_Arc_States;
+
+// NOTE(jakob): Writes the position and velocity of lanes first_lane to
+// first_lane + lane_count - 1 of the volley, as of the start of tick, after
+// (tick - spawn_tick) steps. The states start at index 0.
+typedef void (* Bullet_Arc_Kernel)(const Bullet_Volley *volley, int first_lane, int lane_count, uint32_t tick, Bullet_Arc_States states_out);
+
+typedef struct Bullet_Arc_Variant {
+	const char *name;
+	Bullet_Arc_Kernel kernel;
+	int lanes;
+	bool supported;
+} Bullet_Arc_Variant;
+
+void bullet_arc_scalar(const Bullet_Volley *volley, int first_lane, int lane_count, uint32_t tick, Bullet_Arc_States states_out);
+
+// NOTE(jakob): The arc parameters of a bullet spinning at spin radians per
+// second. A spin too small to show up as a binary angle gets the smallest
+// non-zero turn, which bends a 7 second path by well under a pixel.
+void bullet_arc_from_spin(float spin, float dt, Binary_Angle *half_turn_out, float *arc_scale_out);
+
+// NOTE(jakob): Picks the widest variant the CPU supports. Every variant
+// produces bit-identical results to bullet_arc_scalar.
+void bullet_kernels_init(void);
+
+Bullet_Arc_Kernel bullet_arc_kernel(void);
+
+const char *bullet_arc_kernel_name(void);
+
+// NOTE(jakob): What bullet_kernels_self_check found for each variant, in
+// the order bullet_kernels_init ranks them
+typedef struct Bullet_Kernels_Report {
+#define BULLET_ARC_MAX_VARIANTS 5
+	int variant_count;
+	Bullet_Arc_Variant variants[BULLET_ARC_MAX_VARIANTS];
+	bool variant_matches[BULLET_ARC_MAX_VARIANTS]; // Bit-identical to the scalar path; false when not supported
+	float max_direction_error; // Of the spawn directions of rings and fans of up to 2048 bullets, against libm
+	float max_arc_error; // Of the closed form against stepping, in view units over a bullet lifetime
+} Bullet_Kernels_Report;
+
+// NOTE(jakob): Runs every supported variant against the scalar path on the
+// same volleys and reports any variant whose output is not bit-identical,
+// checks the lanes' spawn directions against libm, and checks the closed
+// form against stepping the same bullets in double precision for a whole
+// bullet lifetime. Fills report_out if given.
+bool bullet_kernels_self_check(float dt, Bullet_Kernels_Report *report_out);
+
+#endif
@@ -0,0 +1,23 @@
+#include "jj_entities.h"
+
+void entity_set_clear(Entity_Set *set, int entity_count) {
+	assert(entity_count >= 0 && entity_count <= MAX_ENTITIES);
+	memset(set, 0, sizeof(*set));
+	set->word_count = (entity_count + 63)/64;
+}
+
+void entity_add(Entity_Set *set, int entity, Entity_Component component) {
+	assert(entity >= 0 && entity/64 < set->word_count);
+	uint64_t *word = &set->bits[component][entity/64];
+	uint64_t bit = 1ull << (entity%64);
+	set->counts[component] += !(*word & bit);
+	*word |= bit;
+}
+
+void entity_remove(Entity_Set *set, int entity, Entity_Component component) {
+	assert(entity >= 0 && entity/64 < set->word_count);
+	uint64_t *word = &set->bits[component][entity/64];
+	uint64_t bit = 1ull << (entity%64);
+	set->counts[component] -= !!(*word & bit);
+	*word &= ~bit;
+}
@@ -0,0 +1,119 @@
+#ifndef JJ_ENTITIES_H
+#define JJ_ENTITIES_H
+
+// NOTE(jakob): An entity is an index into dense per-component arrays. The
+// players of a match are the entities of Sim_State.entities, indexing
+// Sim_State.players and player_bots, the per-player arrays of the grid, the
+// sweep and the contacts, and the front-end's player params and presentation.
+// The front-end's explosion rings are the entities of Game_State.ring_entities,
+// indexing its rings. Which entities have a component is one bitset per
+// component, and the components an entity has make up its archetype. A system
+// asks for the components it needs and the ones it must not have, and visits
+// the matching entities in ascending order, 64 at a time per word of the
+// bitsets.
+//
+// The fixed tick, the state hash and the front-end's updates and drawing all
+// walk players and rings through queries, so a new kind of entity or state
+// is a new component instead of a new check in every loop.
+//
+// Bullets are not entities of a set. A set holds at most MAX_ENTITIES, and a
+// match has tens of thousands of bullets in a pool that grows at runtime and
+// expires a prefix of volleys every window (see Bullet_Pool). Their alive
+// lanes are walked with the same bit iteration.
+typedef enum Entity_Component {
+	ENTITY_PLAYER = 0, // In the match
+	ENTITY_ALIVE, // Has health left; removed at the end of the hit merge of the tick it dies in
+	ENTITY_LOCAL, // Driven by Sim_State.local_inputs
+	ENTITY_BOT, // Driven by Sim_State.player_bots
+	ENTITY_RING, // A live explosion ring of the front-end
+
+	ENTITY_COMPONENT_COUNT
+} Entity_Component;
+
+#define ENTITY_MASK(component) (1u << (component))
+
+typedef struct Entity_Set {
+#define MAX_ENTITIES 256
+#define ENTITY_WORDS ((MAX_ENTITIES + 63)/64)
+	int word_count; // Covering the entities of the match
+	int counts[ENTITY_COMPONENT_COUNT];
+	uint64_t bits[ENTITY_COMPONENT_COUNT][ENTITY_WORDS];
+} Entity_Set;
+
+typedef struct Entity_Query {
+	const Entity_Set *set;
+	uint32_t with;
+	uint32_t without;
+	int word_index;
+	uint64_t word; // Matching entities of word_index not visited yet
+} Entity_Query;
+
+// NOTE(jakob): Index of the lowest set bit of a non-zero word. Loops clear it
+// with word &= word - 1, so they visit the set bits in ascending order.
+static inline int bits_lowest(uint64_t word) {
+	return __builtin_ctzll(word);
+}
+
+// NOTE(jakob): The first set bit at or after index among the first bit_count
+// bits of words, or -1
+static inline int bits_next(const uint64_t *words, int bit_count, int index) {
+	if (index >= bit_count) return -1;
+	int word_index = index/64;
+	uint64_t word = words[word_index] & (~0ull << (index%64));
+	while (!word) {
+		if (++word_index*64 >= bit_count) return -1;
+		word = words[word_index];
+	}
+	int bit = word_index*64 + bits_lowest(word);
+	return bit < bit_count ? bit : -1;
+}
+
+void entity_set_clear(Entity_Set *set, int entity_count);
+
+void entity_add(Entity_Set *set, int entity, Entity_Component component);
+
+void entity_remove(Entity_Set *set, int entity, Entity_Component component);
+
+static inline bool entity_has(const Entity_Set *set, int entity, Entity_Component component) {
+	return (set->bits[component][entity/64] >> (entity%64)) & 1;
+}
+
+static inline int entity_count(const Entity_Set *set, Entity_Component component) {
+	return set->counts[component];
+}
+
+static inline uint64_t entity_query_word(const Entity_Set *set, uint32_t with, uint32_t without, int word_index) {
+	uint64_t word = ~0ull;
+	for (int component = 0; component < ENTITY_COMPONENT_COUNT; ++component) {
+		if (with & ENTITY_MASK(component)) word &= set->bits[component][word_index];
+		if (without & ENTITY_MASK(component)) word &= ~set->bits[component][word_index];
+	}
+	return word;
+}
+
+// NOTE(jakob): The entities that have every component of with and none of
+// without. Walk them with
+//
+//   Entity_Query query = entity_query(set, with, without);
+//   for (int entity; (entity = entity_query_next(&query)) >= 0;) { ... }
+//
+// A word is matched when the walk reaches it, so a component removed from an
+// entity later in the walk's current word is still visited.
+static inline Entity_Query entity_query(const Entity_Set *set, uint32_t with, uint32_t without) {
+	Entity_Query query = {set, with, without, 0, 0};
+	if (set->word_count > 0) query.word = entity_query_word(set, with, without, 0);
+	return query;
+}
+
+// NOTE(jakob): The next matching entity, or -1 after the last
+static inline int entity_query_next(Entity_Query *query) {
+	while (!query->word) {
+		if (++query->word_index >= query->set->word_count) return -1;
+		query->word = entity_query_word(query->set, query->with, query->without, query->word_index);
+	}
+	int entity = query->word_index*64 + bits_lowest(query->word);
+	query->word &= query->word - 1;
+	return entity;
+}
+
+#endif
@@ -0,0 +1,194 @@
+#include "jj_fixed.h"
+
+// NOTE(jakob): The constants are written out rather than computed with libm
+// at startup, so every build starts from the same bits.
+#define FIXED30_PI_OVER_4 843314857 // PI/4 in Q30
+#define BINARY_ANGLE_PER_RADIAN 683565275.57643159 // 2^32/(2*PI)
+#define RADIANS_PER_BINARY_ANGLE 1.4629180792671596e-09f // 2*PI/2^32
+#define FIXED_TRIG_MAX_ERROR 1e-6f
+
+// Taylor coefficients in Q30
+#define FIXED30_SIN_3 178956971 // 1/3!
+#define FIXED30_SIN_5 8947849 // 1/5!
+#define FIXED30_SIN_7 213044 // 1/7!
+#define FIXED30_SIN_9 2959 // 1/9!
+#define FIXED30_COS_2 536870912 // 1/2!
+#define FIXED30_COS_4 44739243 // 1/4!
+#define FIXED30_COS_6 1491308 // 1/6!
+#define FIXED30_COS_8 26631 // 1/8!
+#define FIXED30_COS_10 296 // 1/10!
+
+// atan(2^-i) as binary angles
+static const Binary_Angle cordic_angles[] = {
+	536870912, 316933406, 167458907, 85004756, 42667331, 21354465, 10679838, 5340245,
+	2670163, 1335087, 667544, 333772, 166886, 83443, 41722, 20861,
+	10430, 5215, 2608, 1304, 652, 326, 163, 81,
+	41, 20, 10, 5, 3, 1,
+};
+
+#define CORDIC_ITERATIONS (int)(sizeof(cordic_angles)/sizeof(cordic_angles[0]))
+
+Binary_Angle binary_angle_from_radians(float radians) {
+	// Truncates toward zero, then wraps to a turn
+	int64_t turns_fraction = (int64_t)((double)radians*BINARY_ANGLE_PER_RADIAN);
+	return (Binary_Angle)turns_fraction;
+}
+
+float binary_angle_to_radians(Binary_Angle angle) {
+	return (float)(int32_t)angle*RADIANS_PER_BINARY_ANGLE;
+}
+
+// NOTE(jakob): Each octant is mapped onto x in [0, PI/4], where the Taylor
+// polynomials are accurate to about 1e-9. Every intermediate stays
+// non-negative, so the shifts are plain divisions by powers of two.
+void fixed30_sin_cos(Binary_Angle angle, Fixed30 *sin_out, Fixed30 *cos_out) {
+	uint32_t octant = angle >> 29;
+	uint32_t fraction = angle & ((1u << 29) - 1);
+
+	if (octant & 1) {
+		fraction = (1u << 29) - fraction;
+	}
+
+	int64_t x = ((int64_t)fraction*FIXED30_PI_OVER_4) >> 29;
+	int64_t x2 = (x*x) >> 30;
+
+	int64_t s = FIXED30_SIN_9;
+	s = FIXED30_SIN_7 - ((x2*s) >> 30);
+	s = FIXED30_SIN_5 - ((x2*s) >> 30);
+	s = FIXED30_SIN_3 - ((x2*s) >> 30);
+	s = FIXED30_ONE - ((x2*s) >> 30);
+	s = (x*s) >> 30;
+
+	int64_t c = FIXED30_COS_10;
+	c = FIXED30_COS_8 - ((x2*c) >> 30);
+	c = FIXED30_COS_6 - ((x2*c) >> 30);
+	c = FIXED30_COS_4 - ((x2*c) >> 30);
+	c = FIXED30_COS_2 - ((x2*c) >> 30);
+	c = FIXED30_ONE - ((x2*c) >> 30);
+
+	// Octants 1, 2, 5 and 6 swap sine and cosine
+	if (((octant + 1) >> 1) & 1) {
+		int64_t swap = s;
+		s = c;
+		c = swap;
+	}
+
+	*sin_out = (Fixed30)(octant >= 4 ? -s : s);
+	*cos_out = (Fixed30)((octant + 2) & 4 ? -c : c);
+}
+
+// NOTE(jakob): Vectoring mode: rotate (x, y) onto the positive x axis by
+// +-atan(2^-i) and add up the rotations. Relies on >> of negative values
+// being an arithmetic shift, as it is with every x86-64 compiler.
+Binary_Angle fixed_atan2(int32_t y, int32_t x) {
+	int64_t cx = x;
+	int64_t cy = y;
+	Binary_Angle angle = 0;
+
+	if (cx < 0) {
+		cx = -cx;
+		cy = -cy;
+		angle = 0x80000000u;
+	}
+
+	for (int i = 0; i < CORDIC_ITERATIONS; ++i) {
+		int64_t next_x;
+		if (cy > 0) {
+			next_x = cx + (cy >> i);
+			cy = cy - (cx >> i);
+			angle += cordic_angles[i];
+		}
+		else {
+			next_x = cx - (cy >> i);
+			cy = cy + (cx >> i);
+			angle -= cordic_angles[i];
+		}
+		cx = next_x;
+	}
+
+	return angle;
+}
+
+static float fixed_sinf(float radians) {
+	Fixed30 s, c;
+	fixed30_sin_cos(binary_angle_from_radians(radians), &s, &c);
+	return (float)s*(1.0f/FIXED30_ONE);
+}
+
+static float fixed_cosf(float radians) {
+	Fixed30 s, c;
+	fixed30_sin_cos(binary_angle_from_radians(radians), &s, &c);
+	return (float)c*(1.0f/FIXED30_ONE);
+}
+
+static float fixed_atan2f(float y, float x) {
+	if (y == 0.0f && x == 0.0f) return 0.0f;
+
+	// Scale both exactly by a power of two so the larger lands in [2^29, 2^30)
+	int exponent_y, exponent_x;
+	frexpf(y, &exponent_y);
+	frexpf(x, &exponent_x);
+	int scale = 30 - (exponent_y > exponent_x ? exponent_y : exponent_x);
+
+	int32_t fixed_y = (int32_t)ldexpf(y, scale);
+	int32_t fixed_x = (int32_t)ldexpf(x, scale);
+
+	return binary_angle_to_radians(fixed_atan2(fixed_y, fixed_x));
+}
+
+float sim_sinf(float radians) {
+#if JJ_DETERMINISTIC
+	return fixed_sinf(radians);
+#else
+	return sinf(radians);
+#endif
+}
+
+float sim_cosf(float radians) {
+#if JJ_DETERMINISTIC
+	return fixed_cosf(radians);
+#else
+	return cosf(radians);
+#endif
+}
+
+float sim_atan2f(float y, float x) {
+#if JJ_DETERMINISTIC
+	return fixed_atan2f(y, x);
+#else
+	return atan2f(y, x);
+#endif
+}
+
+bool fixed_trig_self_check(float *max_error_out) {
+	enum { CHECK_ANGLES = 4096 };
+
+	float max_error = 0.0f;
+
+	for (int i = -CHECK_ANGLES; i <= CHECK_ANGLES; ++i) {
+		float radians = (float)i*(3.0f*PI/CHECK_ANGLES);
+
+		float sin_error = fabsf(fixed_sinf(radians) - sinf(radians));
+		float cos_error = fabsf(fixed_cosf(radians) - cosf(radians));
+
+		// Vectors of varying length, to exercise the scaling
+		float length = 1.0f + (float)(i & 7)*100.0f;
+		float y = sinf(radians)*length;
+		float x = cosf(radians)*length;
+		float atan_error = fabsf(fixed_atan2f(y, x) - atan2f(y, x));
+		if (atan_error > PI) atan_error = fabsf(atan_error - 2.0f*PI);
+
+		if (sin_error > max_error) max_error = sin_error;
+		if (cos_error > max_error) max_error = cos_error;
+		if (atan_error > max_error) max_error = atan_error;
+	}
+
+	if (max_error_out) *max_error_out = max_error;
+
+	if (max_error > FIXED_TRIG_MAX_ERROR) {
+		fprintf(stderr, "Fixed-point trigonometry is off by %g from libm\n", (double)max_error);
+		return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,60 @@
+#ifndef JJ_FIXED_H
+#define JJ_FIXED_H
+
+// NOTE(jakob): Deterministic trigonometry. Build with -DJJ_DETERMINISTIC=1 to
+// route the trigonometry of the fixed tick through the integer
+// implementations below. This is not a fixed-point simulation: positions,
+// velocities and the sweeps stay float. That plain IEEE float arithmetic (+,
+// -, *, / and sqrtf) gives the same bits on every x86-64 build as long as
+// nothing is fused or reassociated, which the checks below enforce, so the
+// whole tick then only depends on its inputs. Fixed30 is only used inside
+// the trigonometry.
+#ifndef JJ_DETERMINISTIC
+#define JJ_DETERMINISTIC 0
+#endif
+
+#if JJ_DETERMINISTIC
+#include <float.h>
+#if defined(__FAST_MATH__)
+#error "JJ_DETERMINISTIC needs IEEE float semantics; build without -ffast-math"
+#endif
+#if FLT_EVAL_METHOD != 0
+#error "JJ_DETERMINISTIC needs float evaluated as float (SSE2, not x87)"
+#endif
+#ifdef __clang__
+#pragma STDC FP_CONTRACT OFF
+#elif defined(__GNUC__) && defined(__FP_FAST_FMAF) && !defined(__STRICT_ANSI__) && !defined(JJ_FP_CONTRACT_OFF)
+// NOTE(jakob): GNU C modes fuse a*b + c into FMAs when the target has them
+#error "JJ_DETERMINISTIC needs -std=c99, or -ffp-contract=off -DJJ_FP_CONTRACT_OFF"
+#endif
+#endif
+
+// NOTE(jakob): An angle as a fraction of a full turn, 2^32 per turn, so angle
+// sums wrap around for free
+typedef uint32_t Binary_Angle;
+
+// Fixed-point number with 30 fraction bits
+typedef int32_t Fixed30;
+#define FIXED30_ONE (1 << 30)
+
+Binary_Angle binary_angle_from_radians(float radians);
+
+// NOTE(jakob): Returns the angle in [-PI, PI)
+float binary_angle_to_radians(Binary_Angle angle);
+
+void fixed30_sin_cos(Binary_Angle angle, Fixed30 *sin_out, Fixed30 *cos_out);
+
+// NOTE(jakob): CORDIC on integers; y and x only need the same scale
+Binary_Angle fixed_atan2(int32_t y, int32_t x);
+
+// NOTE(jakob): What the fixed tick calls instead of libm. These are the libm
+// functions unless JJ_DETERMINISTIC is set.
+float sim_sinf(float radians);
+float sim_cosf(float radians);
+float sim_atan2f(float y, float x);
+
+// NOTE(jakob): Compares the integer trigonometry with libm over a sweep of
+// angles and reports the largest error in max_error_out.
+bool fixed_trig_self_check(float *max_error_out);
+
+#endif
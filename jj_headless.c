@@ -0,0 +1,222 @@
+// NOTE(jakob): Runs all-bot matches on libjj_sim without a window or audio,
+// for dedicated servers, batch runs and benchmarks on machines without a
+// display. Prints the tick rate, the event counts and the state hash, so runs
+// can be compared across builds, machines and thread counts.
+//
+// Usage: jj_headless --selfcheck
+//        jj_headless [players] [ticks] [threads] [starting health] [seed] [bullets cancel out (0/1)] [arena screens per side] [obstacle file, or - for none] [bullet tick divisor]
+//
+// Lobbies of 2 to 4 players use tests written out for their size; running
+// the same match with JJ_SIM_GENERIC=1 set compares them with the generic
+// ones, which must give the same state hash.
+//
+// JJ_HEADLESS_MIN_BULLETS=<n> keeps at least n bullets alive by firing
+// 128-bullet rings from random living players before each tick, for
+// benchmarking bullet-heavy matches such as the 8k-bullet annihilation case.
+//
+// --selfcheck runs every bullet arc kernel this CPU supports against the
+// scalar one, reports how far the spawn directions and the arcs drift from
+// libm and from stepping the bullets, checks the deterministic trig against
+// libm, and exits with 1 if any check fails.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "jj_sim.h"
+
+typedef struct Headless_Counts {
+	long events[SIM_EVENT_ANNIHILATION + 1];
+	long bullet_ticks; // Active bullets summed over ticks
+	long bullet_checks; // Live bullets tested, summed over ticks
+	long bullet_checks_skipped; // Live bullets in sleeping volleys, summed over ticks
+	long bullets_stopped_by_obstacles;
+	long player_pairs; // Candidate pairs from the broadphase, summed over ticks
+	long player_pairs_possible; // Pairs of living players, summed over ticks
+	long player_contacts;
+	long bullet_annihilation_tests;
+	long bullets_annihilated;
+	int matches;
+} Headless_Counts;
+
+static void headless_count_events(Sim_State *sim, const Sim_Event *events, int count, void *user_data) {
+	Headless_Counts *counts = user_data;
+
+	for (int event_index = 0; event_index < count; ++event_index) {
+		++counts->events[events[event_index].type];
+	}
+
+	counts->bullet_ticks += sim->bullets.active_bullets;
+	counts->bullet_checks += sim->collision_stats.bullet_checks;
+	counts->bullet_checks_skipped += sim->collision_stats.bullet_checks_skipped;
+	counts->bullets_stopped_by_obstacles += sim->collision_stats.bullets_stopped_by_obstacles;
+	counts->bullet_annihilation_tests += sim->collision_stats.bullet_annihilation_tests;
+	counts->bullets_annihilated += sim->collision_stats.bullets_annihilated;
+
+	long living = entity_count(&sim->entities, ENTITY_ALIVE);
+	counts->player_pairs += sim->player_sweep.pair_count;
+	counts->player_pairs_possible += living*(living - 1)/2;
+	counts->player_contacts += sim->collision_stats.player_contacts;
+}
+
+static double headless_seconds(void) {
+	struct timespec time;
+	clock_gettime(CLOCK_MONOTONIC, &time);
+	return (double)time.tv_sec + 1e-9*(double)time.tv_nsec;
+}
+
+static int headless_self_check(void) {
+	bullet_kernels_init();
+
+	Bullet_Kernels_Report report;
+	bool kernels_match = bullet_kernels_self_check(TIME_STEP_FIXED, &report);
+
+	for (int variant_index = 0; variant_index < report.variant_count; ++variant_index) {
+		Bullet_Arc_Variant *variant = &report.variants[variant_index];
+		printf("Bullet arc kernel %-8s %2d lanes: %s\n", variant->name, variant->lanes,
+			!variant->supported ? "not supported by this CPU" :
+			report.variant_matches[variant_index] ? "matches scalar" : "DIFFERS from scalar");
+	}
+	printf("Selected kernel: %s\n", bullet_arc_kernel_name());
+	printf("Spawn directions: off by at most %.3g from libm\n", (double)report.max_direction_error);
+	printf("Bullet arcs: drift at most %.3g units from stepping them over a lifetime\n", (double)report.max_arc_error);
+
+	float max_trig_error;
+	bool trig_matches = fixed_trig_self_check(&max_trig_error);
+	printf("Deterministic trig: off by at most %.3g from libm%s\n", (double)max_trig_error,
+		sim_deterministic ? "" : " (not used by this build)");
+
+	bool passed = kernels_match && trig_matches;
+	printf("Self-check %s\n", passed ? "passed" : "FAILED");
+	return passed ? 0 : 1;
+}
+
+int main(int argc, char **argv) {
+	if (argc > 1 && strcmp(argv[1], "--selfcheck") == 0) {
+		return headless_self_check();
+	}
+
+	int num_players = argc > 1 ? atoi(argv[1]) : 64;
+	long ticks = argc > 2 ? atol(argv[2]) : 10000;
+	int worker_count = argc > 3 ? atoi(argv[3]) : 0;
+	int starting_health = argc > 4 ? atoi(argv[4]) : sim_default_params.starting_health;
+	uint64_t seed = argc > 5 ? strtoull(argv[5], NULL, 0) : 12345;
+	bool bullet_annihilation = argc > 6 ? atoi(argv[6]) != 0 : sim_default_params.bullet_annihilation;
+	int arena_screens = argc > 7 ? MAXIMUM(1, atoi(argv[7])) : 1;
+	const char *obstacle_path = argc > 8 && strcmp(argv[8], "-") != 0 ? argv[8] : NULL;
+	int bullet_tick_divisor = argc > 9 ? atoi(argv[9]) : sim_default_params.bullet_tick_divisor;
+
+	const char *min_bullets_override = getenv("JJ_HEADLESS_MIN_BULLETS");
+	int min_bullets = min_bullets_override ? atoi(min_bullets_override) : 0;
+	uint64_t top_up_random_state = seed ^ 0x9E3779B97F4A7C15ull;
+
+	Sim_State *sim = calloc(1, sizeof(*sim));
+	assert(sim);
+
+	sim_init(sim, worker_count);
+	sim->random_state = seed ? seed : 1;
+
+	Headless_Counts counts = {0};
+	sim_events_add_consumer(&sim->events, headless_count_events, &counts);
+
+	Game_Parameters params = sim_default_params;
+	params.num_players = num_players;
+	params.num_local_players = 0;
+	params.starting_health = MAXIMUM(1, starting_health);
+	params.bullet_annihilation = bullet_annihilation;
+	params.obstacles = obstacle_path != NULL;
+	params.bullet_tick_divisor = bullet_tick_divisor;
+
+	if (obstacle_path && !obstacle_field_load(&sim->obstacles, obstacle_path)) {
+		sim_shutdown(sim);
+		free(sim);
+		return 1;
+	}
+
+	// NOTE(jakob): The arena of a 1440x900 window, which is one view unit per
+	// pixel, or arena_screens of them per side. The benchmark arena is 10x10.
+	Sim_Arena arena = {1440.0f*(float)arena_screens, 900.0f*(float)arena_screens};
+
+	sim_reset(sim, &params, arena);
+
+	double start_time = headless_seconds();
+
+	// A decided match ends 5 seconds after the win, and the next one starts
+	long ticks_after_win = (long)(5.0f/TIME_STEP_FIXED);
+	long win_tick = -1;
+
+	for (long tick = 0; tick < ticks; ++tick) {
+		int living_count = entity_count(&sim->entities, ENTITY_ALIVE);
+
+		while (sim->bullets.active_bullets < min_bullets && living_count > 0) {
+			int living_index = (int)(random_01(&top_up_random_state)*(float)living_count) % living_count;
+			float speed = 150.0f + 150.0f*random_01(&top_up_random_state);
+			float spin = 0.3f*(random_01(&top_up_random_state) - 0.5f);
+
+			// Stop at the bullet memory budget
+			int dropped_bullets = sim->bullets.metrics.dropped_bullets;
+			Entity_Query living = entity_query(&sim->entities, ENTITY_MASK(ENTITY_ALIVE), 0);
+			int player_index = entity_query_next(&living);
+			while (living_index-- > 0) player_index = entity_query_next(&living);
+
+			spawn_bullet_ring_ex(&sim->players[player_index], sim, 128, speed, spin);
+			if (sim->bullets.metrics.dropped_bullets != dropped_bullets) break;
+		}
+
+		sim_update_fixed(sim);
+		sim_events_dispatch(sim);
+
+		if (sim->triumphant_player >= 0 && win_tick < 0) {
+			win_tick = tick;
+			printf("Match %d: player %d won after %u ticks, hash %016llx\n",
+				counts.matches + 1, sim->triumphant_player + 1, sim->tick_count,
+				(unsigned long long)sim_state_hash(sim));
+		}
+
+		if (win_tick >= 0 && tick - win_tick >= ticks_after_win) {
+			++counts.matches;
+			sim_reset(sim, &params, arena);
+			win_tick = -1;
+		}
+	}
+
+	double seconds = headless_seconds() - start_time;
+
+	printf("%ld ticks of %d players in a %dx%d screen arena on %d threads (%.0f Hz, bullets at %.0f Hz%s, %s tests) in %.3f s: %.0f ticks/s, %.2f us/tick\n",
+		ticks, sim->params.num_players, arena_screens, arena_screens, sim->workers.worker_count,
+		1.0/TIME_STEP_FIXED, 1.0/(TIME_STEP_FIXED*sim->params.bullet_tick_divisor), sim_deterministic ? ", deterministic trig" : "", sim_lobby_variant_name(sim),
+		seconds, seconds > 0.0 ? (double)ticks/seconds : 0.0, ticks > 0 ? 1e6*seconds/(double)ticks : 0.0);
+	printf("Events: %ld hits, %ld pops, %ld rings, %ld deaths, %ld wins, %ld annihilations\n",
+		counts.events[SIM_EVENT_HIT], counts.events[SIM_EVENT_POP], counts.events[SIM_EVENT_RING],
+		counts.events[SIM_EVENT_DEATH], counts.events[SIM_EVENT_WIN], counts.events[SIM_EVENT_ANNIHILATION]);
+	printf("Bullets: %.1f active on average; this match peaked at %d in %d volleys, %d dropped, %.1f KB reserved\n",
+		ticks > 0 ? (double)counts.bullet_ticks/(double)ticks : 0.0,
+		sim->bullets.metrics.peak_active_bullets, sim->bullets.metrics.peak_active_volleys,
+		sim->bullets.metrics.dropped_bullets, (double)sim->bullets.metrics.bytes_reserved/1024.0);
+	printf("Player pairs: %.1f sweep candidates per tick out of %.1f, %.1f solver contacts\n",
+		ticks > 0 ? (double)counts.player_pairs/(double)ticks : 0.0,
+		ticks > 0 ? (double)counts.player_pairs_possible/(double)ticks : 0.0,
+		ticks > 0 ? (double)counts.player_contacts/(double)ticks : 0.0);
+	long bullet_checks = counts.bullet_checks + counts.bullet_checks_skipped;
+	printf("Bullet checks: %.1f%% of %ld avoided by conservative advancement\n",
+		bullet_checks > 0 ? 100.0*(double)counts.bullet_checks_skipped/(double)bullet_checks : 0.0, bullet_checks);
+	if (params.bullet_annihilation) {
+		printf("Annihilation: %.0f bullet pairs tested and %.1f bullets cancelled per tick\n",
+			ticks > 0 ? (double)counts.bullet_annihilation_tests/(double)ticks : 0.0,
+			ticks > 0 ? (double)counts.bullets_annihilated/(double)ticks : 0.0);
+	}
+	if (params.obstacles) {
+		printf("Obstacles: %d shapes in a %dx%d distance grid, %ld bullets stopped\n",
+			sim->obstacles.shape_count, sim->obstacles.columns, sim->obstacles.rows, counts.bullets_stopped_by_obstacles);
+	}
+	printf("State: %016llx after tick %u of the current match\n",
+		(unsigned long long)sim_state_hash(sim), sim->tick_count);
+
+	sim_shutdown(sim);
+	free(sim);
+
+	return 0;
+}
@@ -1,5 +1,5 @@
 #include "jj_math.h"
-#include <raymath.h>
+#include "jj_vector.h"
 
 
 float sign_float(float v) {
@@ -75,3 +75,31 @@ Intersection_Points intersection_points_from_two_circles(Circle c1, Circle c2) {
 
     return result;
 }
+
+float circle_sweep_time_of_impact(Vector2 relative_start, Vector2 relative_motion, float radii_sum) {
+
+    float c = Vector2LengthSqr(relative_start) - radii_sum*radii_sum;
+
+    if (c <= 0.0f) {
+        // Already overlapping at the start of the motion
+        return 0.0f;
+    }
+
+    float a = Vector2LengthSqr(relative_motion);
+    float b = Vector2DotProduct(relative_start, relative_motion);
+
+    if (a == 0.0f || b >= 0.0f) {
+        // Not moving, or moving apart
+        return -1.0f;
+    }
+
+    float discriminant = b*b - a*c;
+
+    if (discriminant < 0.0f) {
+        return -1.0f;
+    }
+
+    float t = (-b - sqrtf(discriminant)) / a;
+
+    return t <= 1.0f ? t : -1.0f;
+}
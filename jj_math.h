@@ -26,4 +26,9 @@ Vector2 Vector2NormalizeOrZero(Vector2 v);
 
 Intersection_Points intersection_points_from_two_circles(Circle c1, Circle c2);
 
+// NOTE(jakob): Returns the earliest t in [0, 1] at which a circle starting at
+// relative_start and moving by relative_motion (both relative to the center of
+// another circle) touches it, or -1 if it does not within the motion.
+float circle_sweep_time_of_impact(Vector2 relative_start, Vector2 relative_motion, float radii_sum);
+
 #endif
@@ -0,0 +1,203 @@
+#include "jj_obstacles.h"
+
+// NOTE(jakob): Exact signed distance from position to one shape
+static float obstacle_shape_distance(const Obstacle_Shape *shape, Vector2 position) {
+	switch (shape->type) {
+		case OBSTACLE_CIRCLE: {
+			return Vector2Length(Vector2Subtract(position, shape->a)) - shape->thickness;
+		}
+		case OBSTACLE_BOX: {
+			Vector2 center = Vector2Scale(Vector2Add(shape->a, shape->b), 0.5f);
+			Vector2 half_size = Vector2Scale(Vector2Abs(Vector2Subtract(shape->b, shape->a)), 0.5f);
+			Vector2 q = Vector2Subtract(Vector2Abs(Vector2Subtract(position, center)), half_size);
+			float outside = Vector2Length((Vector2){MAXIMUM(q.x, 0.0f), MAXIMUM(q.y, 0.0f)});
+			float inside = MINIMUM(MAXIMUM(q.x, q.y), 0.0f);
+			return outside + inside;
+		}
+		case OBSTACLE_WALL: {
+			Vector2 segment = Vector2Subtract(shape->b, shape->a);
+			Vector2 relative = Vector2Subtract(position, shape->a);
+			float length_squared = Vector2DotProduct(segment, segment);
+			float t = length_squared > 0.0f ? Vector2DotProduct(relative, segment)/length_squared : 0.0f;
+			t = MAXIMUM(0.0f, MINIMUM(t, 1.0f));
+			return Vector2Length(Vector2Subtract(relative, Vector2Scale(segment, t))) - shape->thickness;
+		}
+	}
+
+	return INFINITY;
+}
+
+static void obstacle_shape_bounds(const Obstacle_Shape *shape, Vector2 *min_out, Vector2 *max_out) {
+	if (shape->type == OBSTACLE_CIRCLE) {
+		*min_out = Vector2AddValue(shape->a, -shape->thickness);
+		*max_out = Vector2AddValue(shape->a, shape->thickness);
+		return;
+	}
+
+	float grow = shape->type == OBSTACLE_WALL ? shape->thickness : 0.0f;
+	*min_out = (Vector2){MINIMUM(shape->a.x, shape->b.x) - grow, MINIMUM(shape->a.y, shape->b.y) - grow};
+	*max_out = (Vector2){MAXIMUM(shape->a.x, shape->b.x) + grow, MAXIMUM(shape->a.y, shape->b.y) + grow};
+}
+
+void obstacle_field_bake(Obstacle_Field *field) {
+	free(field->distance);
+	field->distance = NULL;
+	field->columns = 0;
+	field->rows = 0;
+
+	if (field->shape_count == 0) return;
+
+	Vector2 bounds_min, bounds_max;
+	obstacle_shape_bounds(&field->shapes[0], &bounds_min, &bounds_max);
+
+	for (int shape_index = 1; shape_index < field->shape_count; ++shape_index) {
+		Vector2 shape_min, shape_max;
+		obstacle_shape_bounds(&field->shapes[shape_index], &shape_min, &shape_max);
+		bounds_min = (Vector2){MINIMUM(bounds_min.x, shape_min.x), MINIMUM(bounds_min.y, shape_min.y)};
+		bounds_max = (Vector2){MAXIMUM(bounds_max.x, shape_max.x), MAXIMUM(bounds_max.y, shape_max.y)};
+	}
+
+	bounds_min = Vector2AddValue(bounds_min, -OBSTACLE_FIELD_MARGIN);
+	bounds_max = Vector2AddValue(bounds_max, OBSTACLE_FIELD_MARGIN);
+
+	// Coarser samples for layouts too large for OBSTACLE_FIELD_MAX_SAMPLES
+	float cell_size = OBSTACLE_FIELD_CELL;
+	int columns, rows;
+
+	for (;;) {
+		columns = (int)ceilf((bounds_max.x - bounds_min.x)/cell_size) + 1;
+		rows = (int)ceilf((bounds_max.y - bounds_min.y)/cell_size) + 1;
+		if ((int64_t)columns*rows <= OBSTACLE_FIELD_MAX_SAMPLES) break;
+		cell_size *= 2.0f;
+	}
+
+	field->origin = bounds_min;
+	field->cell_size = cell_size;
+	field->inv_cell_size = 1.0f/cell_size;
+	field->columns = columns;
+	field->rows = rows;
+	REALLOC_ARRAY(field->distance, columns*rows);
+
+	for (int y = 0; y < rows; ++y) {
+		for (int x = 0; x < columns; ++x) {
+			Vector2 sample = Vector2Add(field->origin, (Vector2){(float)x*cell_size, (float)y*cell_size});
+
+			float distance = INFINITY;
+			for (int shape_index = 0; shape_index < field->shape_count; ++shape_index) {
+				distance = MINIMUM(distance, obstacle_shape_distance(&field->shapes[shape_index], sample));
+			}
+
+			field->distance[y*columns + x] = distance;
+		}
+	}
+}
+
+bool obstacle_field_load(Obstacle_Field *field, const char *path) {
+	obstacle_field_release(field);
+
+	FILE *file = fopen(path, "r");
+	if (!file) {
+		fprintf(stderr, "Could not open obstacle file %s\n", path);
+		return false;
+	}
+
+	int shape_capacity = 0;
+	char line[256];
+	int line_number = 0;
+	bool success = true;
+
+	while (fgets(line, sizeof(line), file)) {
+		++line_number;
+
+		char type[16];
+		if (sscanf(line, " %15s", type) != 1 || type[0] == '#') continue;
+
+		Obstacle_Shape shape = {0};
+		bool valid;
+
+		if (strcmp(type, "circle") == 0) {
+			shape.type = OBSTACLE_CIRCLE;
+			valid = sscanf(line, " %*s %f %f %f", &shape.a.x, &shape.a.y, &shape.thickness) == 3;
+		}
+		else if (strcmp(type, "box") == 0) {
+			shape.type = OBSTACLE_BOX;
+			valid = sscanf(line, " %*s %f %f %f %f", &shape.a.x, &shape.a.y, &shape.b.x, &shape.b.y) == 4;
+		}
+		else if (strcmp(type, "wall") == 0) {
+			shape.type = OBSTACLE_WALL;
+			valid = sscanf(line, " %*s %f %f %f %f %f", &shape.a.x, &shape.a.y, &shape.b.x, &shape.b.y, &shape.thickness) == 5;
+		}
+		else {
+			valid = false;
+		}
+
+		if (!valid || !(shape.thickness >= 0.0f)) {
+			fprintf(stderr, "%s:%d: Expected circle <x> <y> <radius>, box <x0> <y0> <x1> <y1> or wall <x0> <y0> <x1> <y1> <half thickness>\n", path, line_number);
+			success = false;
+			break;
+		}
+
+		if (field->shape_count == shape_capacity) {
+			shape_capacity = MAXIMUM(16, 2*shape_capacity);
+			REALLOC_ARRAY(field->shapes, shape_capacity);
+		}
+		field->shapes[field->shape_count++] = shape;
+	}
+
+	fclose(file);
+
+	if (!success) {
+		obstacle_field_release(field);
+		return false;
+	}
+
+	obstacle_field_bake(field);
+	return true;
+}
+
+void obstacle_field_release(Obstacle_Field *field) {
+	free(field->shapes);
+	free(field->distance);
+	*field = (Obstacle_Field){0};
+}
+
+float obstacle_field_distance(const Obstacle_Field *field, Vector2 position, Vector2 *normal_out) {
+	if (!field->distance) {
+		if (normal_out) *normal_out = (Vector2){0};
+		return INFINITY;
+	}
+
+	float grid_x = (position.x - field->origin.x)*field->inv_cell_size;
+	float grid_y = (position.y - field->origin.y)*field->inv_cell_size;
+	float last_x = (float)(field->columns - 1);
+	float last_y = (float)(field->rows - 1);
+
+	if (!(grid_x >= 0.0f && grid_x <= last_x && grid_y >= 0.0f && grid_y <= last_y)) {
+		Vector2 nearest = {
+			field->origin.x + MAXIMUM(0.0f, MINIMUM(grid_x, last_x))*field->cell_size,
+			field->origin.y + MAXIMUM(0.0f, MINIMUM(grid_y, last_y))*field->cell_size,
+		};
+		Vector2 away = Vector2Subtract(position, nearest);
+		if (normal_out) *normal_out = Vector2NormalizeOrZero(away);
+		return OBSTACLE_FIELD_MARGIN + Vector2Length(away);
+	}
+
+	int x = MINIMUM((int)grid_x, field->columns - 2);
+	int y = MINIMUM((int)grid_y, field->rows - 2);
+	float fx = grid_x - (float)x;
+	float fy = grid_y - (float)y;
+
+	const float *top = field->distance + y*field->columns + x;
+	const float *bottom = top + field->columns;
+
+	float top_distance = top[0] + fx*(top[1] - top[0]);
+	float bottom_distance = bottom[0] + fx*(bottom[1] - bottom[0]);
+
+	if (normal_out) {
+		float top_slope = top[1] - top[0];
+		float bottom_slope = bottom[1] - bottom[0];
+		*normal_out = Vector2NormalizeOrZero((Vector2){top_slope + fy*(bottom_slope - top_slope), bottom_distance - top_distance});
+	}
+
+	return top_distance + fy*(bottom_distance - top_distance);
+}
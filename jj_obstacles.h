@@ -0,0 +1,66 @@
+#ifndef JJ_OBSTACLES_H
+#define JJ_OBSTACLES_H
+
+enum Obstacle_Shape_Type {
+	OBSTACLE_CIRCLE = 0,
+	OBSTACLE_BOX,
+	OBSTACLE_WALL,
+};
+
+// NOTE(jakob): A circle is centered on a with radius thickness, a box spans
+// the corners a and b, and a wall is the segment a -> b grown by thickness
+// on every side.
+typedef struct Obstacle_Shape {
+	enum Obstacle_Shape_Type type;
+	Vector2 a;
+	Vector2 b;
+	float thickness;
+} Obstacle_Shape;
+
+// NOTE(jakob): The static obstacles of an arena, baked into a signed distance
+// grid when they are loaded: the distance from each sample to the nearest
+// obstacle, negative inside one. A wall test is then one bilinear sample, and
+// the gradient of the same four samples is the bounce normal, however many
+// shapes the arena has.
+//
+// The grid covers the shapes' bounds grown by OBSTACLE_FIELD_MARGIN. Outside
+// it, the distance is OBSTACLE_FIELD_MARGIN plus the distance to the grid,
+// which never overestimates the distance to the shapes. The samples are
+// exact, so the interpolated distance changes by at most sqrt(2) times the
+// distance moved.
+typedef struct Obstacle_Field {
+#define OBSTACLE_FIELD_CELL 8.0f // Arena units between samples
+#define OBSTACLE_FIELD_MARGIN 256.0f
+#define OBSTACLE_FIELD_MAX_SAMPLES (4096*4096)
+	int shape_count;
+	Obstacle_Shape *shapes; // For drawing them
+
+	Vector2 origin; // Of sample 0, 0
+	float cell_size;
+	float inv_cell_size;
+	int columns; // Of samples
+	int rows;
+	float *distance;
+} Obstacle_Field;
+
+// NOTE(jakob): Reads the shapes from a text file with one shape per line, in
+// arena units (a 1440x900 window is one unit per pixel), and bakes them.
+// Blank lines and lines starting with # are skipped.
+//
+//   circle <x> <y> <radius>
+//   box <x0> <y0> <x1> <y1>
+//   wall <x0> <y0> <x1> <y1> <half thickness>
+//
+// On failure, prints the reason to stderr and leaves the field empty.
+bool obstacle_field_load(Obstacle_Field *field, const char *path);
+
+// NOTE(jakob): Bakes the distance grid of field->shapes
+void obstacle_field_bake(Obstacle_Field *field);
+
+void obstacle_field_release(Obstacle_Field *field);
+
+// NOTE(jakob): The interpolated signed distance at position, and the unit
+// normal pointing away from the nearest obstacle if normal_out is given
+float obstacle_field_distance(const Obstacle_Field *field, Vector2 position, Vector2 *normal_out);
+
+#endif
@@ -0,0 +1,2825 @@
+#include <assert.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+
+#include "jj_sim.h"
+
+// Unity-build of the simulation library
+#include "jj_fixed.c" // First, so its float settings cover the whole library
+#include "jj_math.c"
+#include "jj_bullets.c"
+#include "jj_entities.c"
+#include "jj_obstacles.c"
+#include "jj_threads.c"
+
+float calculate_player_radius(Player *player, Game_Parameters *game_params) {
+	return game_params->minimum_radius + player->energy*1.2f;
+}
+
+float calculate_player_comeback_factor(Player *player, Game_Parameters *game_params) {
+	float result = game_params->comeback_base_factor*(1.0f - ((float)player->health / (float)game_params->starting_health));
+	return result;
+}
+
+
+bool hit_is_hard_enough(float hit) {
+
+	return 200.0f <= fabs(hit);
+}
+
+
+uint64_t xorshift64(uint64_t *state)
+{
+	uint64_t x = *state;
+	x ^= x << 13;
+	x ^= x >> 7;
+	x ^= x << 17;
+	return *state = x;
+}
+
+float random_01(uint64_t *random_state) {
+
+	union {
+		uint32_t as_int;
+		float as_float;
+	} val;
+
+	val.as_int = (xorshift64(random_state)&((1 << 23)-1)) | (127 << 23);
+
+	float result = val.as_float - 1.0f;
+
+	return result;
+}
+
+
+#define BULLET_POOL_BYTES_PER_VOLLEY ( \
+	sizeof(Bullet_Volley) + \
+	sizeof(double) + /* wake_key */ \
+	sizeof(int) + /* first_word */ \
+	sizeof(int) + /* alive_count */ \
+	sizeof(uint32_t) + /* slot */ \
+	sizeof(uint32_t) + /* slot_generation */ \
+	sizeof(int) + /* slot_volley_index */ \
+	sizeof(uint32_t) /* free_slots */ \
+)
+#define BULLET_POOL_BYTES_PER_WORD sizeof(uint64_t) /* alive_words */
+
+static int bullet_pool_word_count(int count) {
+	return (count + 63)/64;
+}
+
+static size_t bullet_pool_bytes(int volley_capacity, int word_capacity) {
+	return (size_t)volley_capacity*BULLET_POOL_BYTES_PER_VOLLEY + (size_t)word_capacity*BULLET_POOL_BYTES_PER_WORD;
+}
+
+static bool bullet_pool_grow(Bullet_Pool *pool, int volley_capacity, int word_capacity) {
+	assert(pool->dense_offset == 0 && pool->word_offset == 0);
+
+	size_t bytes = bullet_pool_bytes(volley_capacity, word_capacity);
+	char *memory = malloc(bytes);
+	if (!memory) return false;
+
+	// NOTE(jakob): Carve all arrays out of one block, 8-byte words first
+	Bullet_Pool grown = *pool;
+	char *cursor = memory;
+	#define CARVE(array, capacity) grown.array = (void *)cursor; cursor += (size_t)(capacity)*sizeof(*grown.array)
+	CARVE(alive_words, word_capacity);
+	CARVE(wake_key, volley_capacity);
+	CARVE(volleys, volley_capacity);
+	CARVE(first_word, volley_capacity);
+	CARVE(alive_count, volley_capacity);
+	CARVE(slot, volley_capacity);
+	CARVE(slot_generation, volley_capacity);
+	CARVE(slot_volley_index, volley_capacity);
+	CARVE(free_slots, volley_capacity);
+	#undef CARVE
+
+	int old_volley_capacity = pool->volley_capacity;
+
+	if (old_volley_capacity > 0) {
+		#define COPY(array, count) memcpy(grown.array, pool->array, (size_t)(count)*sizeof(*grown.array))
+		COPY(alive_words, pool->active_words);
+		COPY(volleys, pool->active_volleys);
+		COPY(wake_key, pool->active_volleys);
+		COPY(first_word, pool->active_volleys);
+		COPY(alive_count, pool->active_volleys);
+		COPY(slot, pool->active_volleys);
+		COPY(slot_generation, old_volley_capacity);
+		COPY(slot_volley_index, old_volley_capacity);
+		COPY(free_slots, pool->free_slot_count);
+		#undef COPY
+	}
+
+	// New slots go on the free stack so the lowest slot is handed out first
+	for (int slot = volley_capacity - 1; slot >= old_volley_capacity; --slot) {
+		grown.slot_generation[slot] = 0;
+		grown.free_slots[grown.free_slot_count++] = (uint32_t)slot;
+	}
+
+	free(pool->memory);
+
+	grown.memory = memory;
+	grown.volley_capacity = volley_capacity;
+	grown.word_capacity = word_capacity;
+	grown.metrics.capacity = 64*word_capacity;
+	grown.metrics.volley_capacity = volley_capacity;
+	grown.metrics.bytes_reserved = bytes;
+	++grown.metrics.grow_count;
+
+	*pool = grown;
+
+	return true;
+}
+
+void bullet_pool_release(Bullet_Pool *pool) {
+	free(pool->memory);
+	*pool = (Bullet_Pool){0};
+}
+
+uint64_t *bullet_pool_alive_words(Bullet_Pool *pool, int volley_index) {
+	return pool->alive_words + (pool->first_word[volley_index] - pool->word_offset);
+}
+
+// NOTE(jakob): Moves the dense arrays back to the start of their allocation
+static void bullet_pool_slide_to_start(Bullet_Pool *pool) {
+	int offset = pool->dense_offset;
+	int word_offset = pool->word_offset;
+	if (offset == 0 && word_offset == 0) return;
+
+	int count = pool->active_volleys;
+
+	#define SLIDE(array, offset, count) \
+		memmove(pool->array - (offset), pool->array, (size_t)(count)*sizeof(*pool->array)); \
+		pool->array -= (offset)
+	SLIDE(volleys, offset, count);
+	SLIDE(wake_key, offset, count);
+	SLIDE(first_word, offset, count);
+	SLIDE(alive_count, offset, count);
+	SLIDE(slot, offset, count);
+	SLIDE(alive_words, word_offset, pool->active_words);
+	#undef SLIDE
+
+	pool->dense_offset = 0;
+	pool->word_offset = 0;
+
+	for (int volley_index = 0; volley_index < count; ++volley_index) {
+		pool->first_word[volley_index] -= word_offset;
+		pool->slot_volley_index[pool->slot[volley_index]] = volley_index;
+	}
+}
+
+// NOTE(jakob): Makes room for one more volley of count bullets, growing in
+// whole chunks while the memory budget allows. Returns how many bullets fit;
+// the rest are counted as dropped.
+static int bullet_pool_reserve(Bullet_Pool *pool, int count, size_t memory_budget) {
+	pool->metrics.memory_budget = memory_budget;
+
+	if (count <= 0) return 0;
+
+	int needed_volleys = pool->active_volleys + 1;
+	int needed_words = pool->active_words + bullet_pool_word_count(count);
+
+	if (pool->dense_offset + needed_volleys > pool->volley_capacity || pool->word_offset + needed_words > pool->word_capacity) {
+		bullet_pool_slide_to_start(pool);
+	}
+
+	if (needed_volleys > pool->volley_capacity || needed_words > pool->word_capacity) {
+		int volley_capacity = (needed_volleys + BULLET_POOL_CHUNK - 1)/BULLET_POOL_CHUNK*BULLET_POOL_CHUNK;
+		int word_capacity = (needed_words + BULLET_POOL_WORD_CHUNK - 1)/BULLET_POOL_WORD_CHUNK*BULLET_POOL_WORD_CHUNK;
+		volley_capacity = MAXIMUM(volley_capacity, pool->volley_capacity);
+		word_capacity = MAXIMUM(word_capacity, pool->word_capacity);
+
+		if (bullet_pool_bytes(volley_capacity, word_capacity) <= memory_budget) {
+			bullet_pool_grow(pool, volley_capacity, word_capacity);
+		}
+
+		int fitting = 0;
+		if (needed_volleys <= pool->volley_capacity) {
+			fitting = MINIMUM(count, 64*(pool->word_capacity - pool->active_words));
+		}
+
+		pool->metrics.dropped_bullets += count - fitting;
+		count = fitting;
+	}
+
+	return count;
+}
+
+// NOTE(jakob): Appends a volley of volley->count bullets (already reserved),
+// all alive and awake, and gives it a slot. Returns its volley index.
+static int bullet_pool_push(Bullet_Pool *pool, const Bullet_Volley *volley) {
+	int volley_index = pool->active_volleys;
+	int word_count = bullet_pool_word_count(volley->count);
+	uint32_t slot = pool->free_slots[--pool->free_slot_count];
+
+	pool->volleys[volley_index] = *volley;
+	pool->wake_key[volley_index] = -INFINITY;
+	pool->first_word[volley_index] = pool->word_offset + pool->active_words;
+	pool->alive_count[volley_index] = volley->count;
+	pool->slot[volley_index] = slot;
+	pool->slot_volley_index[slot] = pool->dense_offset + volley_index;
+
+	uint64_t *words = pool->alive_words + pool->active_words;
+
+	for (int word_index = 0; word_index < word_count; ++word_index) {
+		int lanes = MINIMUM(64, volley->count - 64*word_index);
+		words[word_index] = lanes == 64 ? ~(uint64_t)0 : ((uint64_t)1 << lanes) - 1;
+	}
+
+	pool->active_volleys += 1;
+	pool->active_words += word_count;
+	pool->active_bullets += volley->count;
+	pool->metrics.peak_active_bullets = MAXIMUM(pool->metrics.peak_active_bullets, pool->active_bullets);
+	pool->metrics.peak_active_volleys = MAXIMUM(pool->metrics.peak_active_volleys, pool->active_volleys);
+
+	return volley_index;
+}
+
+// NOTE(jakob): Clears the lane's alive bit and returns whether it was set.
+// Leaves active_bullets to the next compaction, so workers can remove lanes
+// of their own volleys.
+static bool bullet_pool_kill_lane(Bullet_Pool *pool, int volley_index, int lane) {
+	uint64_t *word = bullet_pool_alive_words(pool, volley_index) + lane/64;
+	uint64_t bit = (uint64_t)1 << (lane%64);
+
+	if (!(*word & bit)) return false;
+
+	*word &= ~bit;
+	--pool->alive_count[volley_index];
+
+	return true;
+}
+
+bool bullet_pool_lane_alive(Bullet_Pool *pool, int volley_index, int lane) {
+	return (bullet_pool_alive_words(pool, volley_index)[lane/64] >> (lane%64)) & 1;
+}
+
+Bullet_Handle bullet_pool_handle(Bullet_Pool *pool, int volley_index, int lane) {
+	uint32_t slot = pool->slot[volley_index];
+	return (Bullet_Handle){slot, pool->slot_generation[slot], lane};
+}
+
+int bullet_pool_lookup(Bullet_Pool *pool, Bullet_Handle handle) {
+	if (handle.slot >= (uint32_t)pool->volley_capacity) return -1;
+	if (pool->slot_generation[handle.slot] != handle.generation) return -1;
+
+	int volley_index = pool->slot_volley_index[handle.slot] - pool->dense_offset;
+	if (handle.lane < 0 || handle.lane >= pool->volleys[volley_index].count) return -1;
+	if (!bullet_pool_lane_alive(pool, volley_index, handle.lane)) return -1;
+
+	return volley_index;
+}
+
+static void bullet_pool_free_slot(Bullet_Pool *pool, uint32_t slot) {
+	++pool->slot_generation[slot];
+	pool->free_slots[pool->free_slot_count++] = slot;
+}
+
+// NOTE(jakob): Drops the volleys that have taken their last step before tick
+static void bullet_pool_expire(Bullet_Pool *pool, uint32_t tick, uint32_t lifetime_ticks) {
+	int expired = 0;
+	int expired_words = 0;
+
+	while (expired < pool->active_volleys && tick - pool->volleys[expired].spawn_tick >= lifetime_ticks) {
+		bullet_pool_free_slot(pool, pool->slot[expired]);
+		pool->active_bullets -= pool->alive_count[expired];
+		expired_words += bullet_pool_word_count(pool->volleys[expired].count);
+		++expired;
+	}
+
+	if (expired == 0) return;
+
+	pool->volleys += expired;
+	pool->wake_key += expired;
+	pool->first_word += expired;
+	pool->alive_count += expired;
+	pool->slot += expired;
+	pool->alive_words += expired_words;
+
+	pool->dense_offset += expired;
+	pool->word_offset += expired_words;
+	pool->active_volleys -= expired;
+	pool->active_words -= expired_words;
+}
+
+float bullet_pool_age(Bullet_Pool *pool, int volley_index, uint32_t tick) {
+	return (float)(int32_t)(tick - pool->volleys[volley_index].spawn_tick)*TIME_STEP_FIXED;
+}
+
+void bullet_pool_state(Bullet_Pool *pool, int volley_index, int lane, uint32_t tick, Vector2 *position_out, Vector2 *velocity_out) {
+	Vector2 position, velocity;
+	Bullet_Arc_States state = {&position.x, &position.y, &velocity.x, &velocity.y};
+
+	bullet_arc_scalar(&pool->volleys[volley_index], lane, 1, tick, state);
+
+	if (position_out) *position_out = position;
+	if (velocity_out) *velocity_out = velocity;
+}
+
+float bullet_pool_volley_reach(Bullet_Pool *pool, int volley_index, uint32_t tick) {
+	Bullet_Volley *volley = &pool->volleys[volley_index];
+	float steps = (float)(int32_t)(tick - volley->spawn_tick);
+
+	// |sin(k*half_turn)/sin(half_turn)| is at most k and at most 1/|sin(half_turn)|
+	float speed = volley->speed + Vector2Length((Vector2){volley->base_vx, volley->base_vy});
+	return speed*MINIMUM(MAXIMUM(steps, 0.0f)*TIME_STEP_FIXED, fabsf(volley->arc_scale));
+}
+
+// NOTE(jakob): Drops the volleys without live lanes while keeping the order of
+// the rest, and recounts the live bullets. The slots of dropped volleys are
+// freed.
+static void bullet_pool_compact(Bullet_Pool *pool) {
+	int write_index = 0;
+	int write_word = 0;
+	int active_bullets = 0;
+
+	for (int volley_index = 0; volley_index < pool->active_volleys; ++volley_index) {
+		uint32_t slot = pool->slot[volley_index];
+
+		if (pool->alive_count[volley_index] == 0) {
+			bullet_pool_free_slot(pool, slot);
+			continue;
+		}
+
+		int word_count = bullet_pool_word_count(pool->volleys[volley_index].count);
+		int first_word = pool->first_word[volley_index] - pool->word_offset;
+
+		if (write_word != first_word) {
+			memmove(pool->alive_words + write_word, pool->alive_words + first_word, (size_t)word_count*sizeof(*pool->alive_words));
+		}
+
+		if (write_index != volley_index) {
+			pool->volleys[write_index] = pool->volleys[volley_index];
+			pool->wake_key[write_index] = pool->wake_key[volley_index];
+			pool->alive_count[write_index] = pool->alive_count[volley_index];
+			pool->slot[write_index] = slot;
+			pool->slot_volley_index[slot] = pool->dense_offset + write_index;
+		}
+
+		pool->first_word[write_index] = pool->word_offset + write_word;
+		active_bullets += pool->alive_count[write_index];
+
+		write_word += word_count;
+		++write_index;
+	}
+
+	pool->active_volleys = write_index;
+	pool->active_words = write_word;
+	pool->active_bullets = active_bullets;
+}
+
+static void sim_events_begin_tick(Sim_Event_Queue *queue, uint32_t tick) {
+	queue->tick = tick;
+	queue->count = 0;
+}
+
+static void sim_event_push(Sim_State *sim, Sim_Event event) {
+	Sim_Event_Queue *queue = &sim->events;
+
+	if (queue->count == queue->capacity) {
+		queue->capacity = MAXIMUM(64, 2*queue->capacity);
+		REALLOC_ARRAY(queue->events, queue->capacity);
+	}
+
+	queue->events[queue->count++] = event;
+}
+
+// NOTE(jakob): Hands the events of the last tick to every consumer, in the
+// order they were added
+void sim_events_dispatch(Sim_State *sim) {
+	Sim_Event_Queue *queue = &sim->events;
+
+	for (int consumer_index = 0; consumer_index < queue->consumer_count; ++consumer_index) {
+		Sim_Event_Consumer *consumer = &queue->consumers[consumer_index];
+		consumer->callback(sim, queue->events, queue->count, consumer->user_data);
+	}
+
+	queue->count = 0;
+}
+
+bool sim_events_add_consumer(Sim_Event_Queue *queue, Sim_Event_Callback callback, void *user_data) {
+	if (queue->consumer_count == MAX_SIM_EVENT_CONSUMERS) {
+		fprintf(stderr, "Too many simulation event consumers\n");
+		return false;
+	}
+
+	queue->consumers[queue->consumer_count++] = (Sim_Event_Consumer){callback, user_data};
+	return true;
+}
+
+void sim_events_remove_consumer(Sim_Event_Queue *queue, Sim_Event_Callback callback, void *user_data) {
+	for (int consumer_index = 0; consumer_index < queue->consumer_count; ++consumer_index) {
+		Sim_Event_Consumer *consumer = &queue->consumers[consumer_index];
+
+		if (consumer->callback == callback && consumer->user_data == user_data) {
+			memmove(consumer, consumer + 1, (size_t)(queue->consumer_count - consumer_index - 1)*sizeof(*consumer));
+			--queue->consumer_count;
+			return;
+		}
+	}
+}
+
+void spawn_bullet_ring_ex(Player *player, Sim_State *sim, int count, float speed, float spin) {
+	Game_Parameters *game_params = &sim->params;
+	Bullet_Pool *pool = &sim->bullets;
+	int player_index = (int)(player - sim->players);
+
+	count = bullet_pool_reserve(pool, count, game_params->bullet_memory_budget);
+
+	player->energy -= count * game_params->bullet_energy_cost_ring;
+
+	if (player->energy < 0) {
+		player->energy = 0.0f;
+	}
+
+	float start_angle = random_01(&sim->random_state)*2.0f*PI;
+
+	if (count > 0) {
+		Bullet_Volley volley = {
+			.x = player->position.x,
+			.y = player->position.y,
+			.speed = speed,
+			.start_angle = binary_angle_from_radians(start_angle),
+			.angle_step = binary_angle_from_radians(2.0f*PI / (float)count),
+			.owner = player_index,
+			.count = count,
+			.spawn_tick = pool->first_step_tick,
+		};
+		bullet_arc_from_spin(spin, TIME_STEP_FIXED, &volley.half_turn, &volley.arc_scale);
+
+		bullet_pool_push(pool, &volley);
+	}
+
+	sim_event_push(sim, (Sim_Event){
+		.type = SIM_EVENT_POP,
+		.player_index = player_index,
+		.other_player_index = -1,
+		.count = count,
+		.position = player->position,
+	});
+}
+
+void spawn_bullet_ring(Player *player, Sim_State *sim) {
+	Game_Parameters *game_params = &sim->params;
+	float comeback_factor = sim->player_comeback_factor[player - sim->players];
+	int count = (int)((player->energy * (0.5f + 0.5f*comeback_factor)) / game_params->bullet_energy_cost_ring);
+	float speed = 50.0f + Vector2LengthSqr(player->velocity)/1565.0f;
+	float spin = 0.3f*player->angular_velocity;
+	spawn_bullet_ring_ex(player, sim, count, speed, spin);
+}
+
+void spawn_bullet_fan(Player *player, Sim_State *sim, int count, float speed, float angle_span) {
+	Game_Parameters *game_params = &sim->params;
+	Bullet_Pool *pool = &sim->bullets;
+	int player_index = (int)(player - sim->players);
+
+	count = bullet_pool_reserve(pool, count, game_params->bullet_memory_budget);
+
+	player->energy -= count * game_params->bullet_energy_cost_fan;
+
+	if (player->energy < 0) {
+		player->energy = 0.0f;
+	}
+
+	if (count > 0) {
+		float angle_quantum = angle_span / (float)count;
+
+		Vector2 quater_player_velocity = Vector2Scale(player->velocity, 0.25f);
+
+		Bullet_Volley volley = {
+			.x = player->position.x,
+			.y = player->position.y,
+			.base_vx = quater_player_velocity.x,
+			.base_vy = quater_player_velocity.y,
+			.speed = speed,
+			.start_angle = binary_angle_from_radians(player->shoot_angle - 0.5f*angle_span + 0.5f*angle_quantum),
+			.angle_step = binary_angle_from_radians(angle_quantum),
+			.owner = player_index,
+			.count = count,
+			.spawn_tick = pool->first_step_tick,
+		};
+		bullet_arc_from_spin(0.3f*player->angular_velocity, TIME_STEP_FIXED, &volley.half_turn, &volley.arc_scale);
+
+		bullet_pool_push(pool, &volley);
+	}
+
+	sim_event_push(sim, (Sim_Event){
+		.type = SIM_EVENT_POP,
+		.player_index = player_index,
+		.other_player_index = -1,
+		.count = count,
+		.position = player->position,
+	});
+}
+
+
+#define PLAYZONE_MARGIN 100.0f
+#define BULLET_WAKE_MARGIN 1.0f // Covers rounding in the arcs and the grid
+
+bool position_outside_playzone(Vector2 position, Sim_Arena arena) {
+	return (
+		position.x < -PLAYZONE_MARGIN ||
+		position.x >= arena.width + PLAYZONE_MARGIN ||
+		position.y < -PLAYZONE_MARGIN ||
+		position.y >= arena.height + PLAYZONE_MARGIN
+	);
+}
+
+// NOTE(jakob): The obstacle field when this match uses one, otherwise NULL
+static const Obstacle_Field *sim_obstacles(Sim_State *sim) {
+	return sim->params.obstacles && sim->obstacles.distance ? &sim->obstacles : NULL;
+}
+
+static int player_grid_cell_coordinate(Player_Grid *grid, float position, int cell_count) {
+	int cell = (int)((position + PLAYZONE_MARGIN)*grid->inv_cell_size);
+	if (cell < 0) cell = 0;
+	if (cell > cell_count - 1) cell = cell_count - 1;
+	return cell;
+}
+
+static Vector2 *player_grid_path(Player_Grid *grid, int player_index) {
+	return grid->player_path + player_index*(MAX_BULLET_TICK_DIVISOR + 1);
+}
+
+// NOTE(jakob): Marks the blocks touched by the reach box of each living
+// player's path this window, then spreads the distance to the marked blocks
+// with a forward and a backward chamfer pass. The border stays unreachable,
+// so the passes need no bounds checks.
+static void player_grid_build_clearance(Player_Grid *grid, Sim_State *sim, float reach) {
+	int block_tiles = MAXIMUM(
+		(grid->tile_columns + PLAYER_GRID_MAX_BLOCK_DIMENSION - 1)/PLAYER_GRID_MAX_BLOCK_DIMENSION,
+		(grid->tile_rows + PLAYER_GRID_MAX_BLOCK_DIMENSION - 1)/PLAYER_GRID_MAX_BLOCK_DIMENSION
+	);
+	int block_cells = block_tiles*PLAYER_GRID_TILE;
+	int block_columns = (grid->columns + block_cells - 1)/block_cells;
+	int block_rows = (grid->rows + block_cells - 1)/block_cells;
+	int stride = block_columns + 2;
+	uint8_t *clearance = grid->block_clearance + stride + 1;
+
+	grid->block_cells = block_cells;
+	grid->block_columns = block_columns;
+	grid->block_rows = block_rows;
+	memset(grid->block_clearance, UINT8_MAX, stride*(block_rows + 2)*sizeof(*clearance));
+
+	Entity_Query living = entity_query(&sim->entities, ENTITY_MASK(ENTITY_ALIVE), 0);
+	for (int player_index; (player_index = entity_query_next(&living)) >= 0;) {
+		Vector2 path_min = grid->player_path_min[player_index];
+		Vector2 path_max = grid->player_path_max[player_index];
+		int min_x = player_grid_cell_coordinate(grid, path_min.x - reach, grid->columns)/block_cells;
+		int max_x = player_grid_cell_coordinate(grid, path_max.x + reach, grid->columns)/block_cells;
+		int min_y = player_grid_cell_coordinate(grid, path_min.y - reach, grid->rows)/block_cells;
+		int max_y = player_grid_cell_coordinate(grid, path_max.y + reach, grid->rows)/block_cells;
+
+		for (int y = min_y; y <= max_y; ++y) {
+			memset(clearance + y*stride + min_x, 0, (max_x - min_x + 1)*sizeof(*clearance));
+		}
+	}
+
+	for (int y = 0; y < block_rows; ++y) {
+		uint8_t *row = clearance + y*stride;
+		for (int x = 0; x < block_columns; ++x) {
+			int distance = MINIMUM(MINIMUM(row[x - 1], row[x - stride - 1]), MINIMUM(row[x - stride], row[x - stride + 1])) + 1;
+			row[x] = (uint8_t)MINIMUM(row[x], MINIMUM(distance, UINT8_MAX));
+		}
+	}
+
+	for (int y = block_rows - 1; y >= 0; --y) {
+		uint8_t *row = clearance + y*stride;
+		for (int x = block_columns - 1; x >= 0; --x) {
+			int distance = MINIMUM(MINIMUM(row[x + 1], row[x + stride + 1]), MINIMUM(row[x + stride], row[x + stride - 1])) + 1;
+			row[x] = (uint8_t)MINIMUM(row[x], MINIMUM(distance, UINT8_MAX));
+		}
+	}
+}
+
+// NOTE(jakob): A lower bound on the distance from position to the reach of
+// every living player this tick and to the edge of the playzone
+static float player_grid_clearance(Player_Grid *grid, Sim_Arena arena, Vector2 position) {
+	float edge_clearance = MINIMUM(
+		MINIMUM(position.x + PLAYZONE_MARGIN, arena.width + PLAYZONE_MARGIN - position.x),
+		MINIMUM(position.y + PLAYZONE_MARGIN, arena.height + PLAYZONE_MARGIN - position.y)
+	);
+
+	int x = player_grid_cell_coordinate(grid, position.x, grid->columns)/grid->block_cells;
+	int y = player_grid_cell_coordinate(grid, position.y, grid->rows)/grid->block_cells;
+	int blocks = grid->block_clearance[(y + 1)*(grid->block_columns + 2) + x + 1];
+
+	// The blocks up to blocks - 1 rings around the position's block are clear
+	float block_clearance = (float)MAXIMUM(blocks - 1, 0)*(float)grid->block_cells*grid->cell_size;
+
+	return MINIMUM(edge_clearance, block_clearance);
+}
+
+// NOTE(jakob): The index of cell x, y in cell_start, or -1 when its tile
+// is not active this tick
+static int player_grid_cell(Player_Grid *grid, int x, int y) {
+	// Cell coordinates are never negative; unsigned makes / and % shifts and masks
+	unsigned tile_x = (unsigned)x/PLAYER_GRID_TILE;
+	unsigned tile_y = (unsigned)y/PLAYER_GRID_TILE;
+	int slot = grid->tile_slot[tile_y*(unsigned)grid->tile_columns + tile_x];
+	if (slot < 0) return -1;
+	return slot*PLAYER_GRID_TILE_CELLS + (int)(((unsigned)y%PLAYER_GRID_TILE)*PLAYER_GRID_TILE + (unsigned)x%PLAYER_GRID_TILE);
+}
+
+static void player_grid_build(Player_Grid *grid, Sim_State *sim) {
+	Game_Parameters *game_params = &sim->params;
+	Sim_Arena arena = sim->arena;
+
+	float zone_width = arena.width + 2.0f*PLAYZONE_MARGIN;
+	float zone_height = arena.height + 2.0f*PLAYZONE_MARGIN;
+	int divisor = game_params->bullet_tick_divisor;
+
+	float max_player_radius = 0.0f;
+	float max_player_motion = 0.0f;
+	float max_player_travel = 0.0f;
+
+	Entity_Query living = entity_query(&sim->entities, ENTITY_MASK(ENTITY_ALIVE), 0);
+	for (int player_index; (player_index = entity_query_next(&living)) >= 0;) {
+		Player *player = sim->players + player_index;
+
+		float radius = sim->player_sweep.radius[player_index];
+		grid->player_radius[player_index] = radius;
+		max_player_radius = MAXIMUM(max_player_radius, radius);
+
+		Vector2 *path = player_grid_path(grid, player_index);
+		path[divisor] = player->position;
+
+		Vector2 path_min = path[0];
+		Vector2 path_max = path[0];
+		float travel = 0.0f;
+
+		for (int point = 1; point <= divisor; ++point) {
+			Vector2 step = Vector2Abs(Vector2Subtract(path[point], path[point - 1]));
+			travel += step.x + step.y;
+
+			path_min.x = MINIMUM(path_min.x, path[point].x);
+			path_min.y = MINIMUM(path_min.y, path[point].y);
+			path_max.x = MAXIMUM(path_max.x, path[point].x);
+			path_max.y = MAXIMUM(path_max.y, path[point].y);
+		}
+
+		grid->player_path_min[player_index] = path_min;
+		grid->player_path_max[player_index] = path_max;
+		max_player_motion = MAXIMUM(max_player_motion, MAXIMUM(path_max.x - path_min.x, path_max.y - path_min.y));
+		max_player_travel = MAXIMUM(max_player_travel, travel);
+	}
+
+	float reach = game_params->bullet_radius + max_player_radius;
+
+	grid->player_travel += (double)max_player_travel + (double)MAXIMUM(0.0f, reach - grid->max_player_reach);
+	grid->max_player_reach = reach;
+
+	float max_cells = (float)(PLAYER_GRID_TILE*PLAYER_GRID_MAX_TILE_DIMENSION);
+	float cell_size = MAXIMUM(MAXIMUM(reach, max_player_motion), MAXIMUM(zone_width, zone_height)/max_cells);
+
+	grid->cell_size = cell_size;
+	grid->inv_cell_size = 1.0f/cell_size;
+	grid->columns = MINIMUM((int)(zone_width*grid->inv_cell_size) + 1, PLAYER_GRID_TILE*PLAYER_GRID_MAX_TILE_DIMENSION);
+	grid->rows = MINIMUM((int)(zone_height*grid->inv_cell_size) + 1, PLAYER_GRID_TILE*PLAYER_GRID_MAX_TILE_DIMENSION);
+	grid->tile_columns = (grid->columns + PLAYER_GRID_TILE - 1)/PLAYER_GRID_TILE;
+	grid->tile_rows = (grid->rows + PLAYER_GRID_TILE - 1)/PLAYER_GRID_TILE;
+
+	// Deactivate last tick's tiles, which is cheaper than clearing all of them
+	for (int slot = 0; slot < grid->active_tile_count; ++slot) {
+		grid->tile_slot[grid->active_tiles[slot]] = -1;
+	}
+	grid->active_tile_count = 0;
+
+	int *cell_start = grid->cell_start;
+	cell_start[0] = 0;
+
+	// Counting sort: activate tiles and count entries per cell, prefix sum,
+	// then fill. Small lobbies test every opponent and never query the cells.
+	for (int pass = 0; pass < 2 && !sim->lobby_players; ++pass) {
+		Entity_Query living = entity_query(&sim->entities, ENTITY_MASK(ENTITY_ALIVE), 0);
+		for (int player_index; (player_index = entity_query_next(&living)) >= 0;) {
+			float player_reach = grid->player_radius[player_index] + game_params->bullet_radius;
+			Vector2 path_min = grid->player_path_min[player_index];
+			Vector2 path_max = grid->player_path_max[player_index];
+			int min_x = player_grid_cell_coordinate(grid, path_min.x - player_reach, grid->columns);
+			int max_x = player_grid_cell_coordinate(grid, path_max.x + player_reach, grid->columns);
+			int min_y = player_grid_cell_coordinate(grid, path_min.y - player_reach, grid->rows);
+			int max_y = player_grid_cell_coordinate(grid, path_max.y + player_reach, grid->rows);
+
+			for (int y = min_y; y <= max_y; ++y) {
+				for (int x = min_x; x <= max_x; ++x) {
+					if (pass == 0) {
+						int tile = (y/PLAYER_GRID_TILE)*grid->tile_columns + x/PLAYER_GRID_TILE;
+						int *slot = &grid->tile_slot[tile];
+						if (*slot < 0) {
+							*slot = grid->active_tile_count++;
+							grid->active_tiles[*slot] = tile;
+							memset(cell_start + *slot*PLAYER_GRID_TILE_CELLS + 1, 0, PLAYER_GRID_TILE_CELLS*sizeof(*cell_start));
+						}
+						++cell_start[player_grid_cell(grid, x, y) + 1];
+					}
+					else {
+						grid->entries[cell_start[player_grid_cell(grid, x, y)]++] = player_index;
+					}
+				}
+			}
+		}
+
+		int cell_count = grid->active_tile_count*PLAYER_GRID_TILE_CELLS;
+
+		if (pass == 0) {
+			for (int cell = 0; cell < cell_count; ++cell) {
+				cell_start[cell + 1] += cell_start[cell];
+			}
+			assert(grid->active_tile_count <= sim->player_capacity*PLAYER_GRID_TILES_PER_PLAYER);
+			assert(cell_start[cell_count] <= sim->player_capacity*PLAYER_GRID_ENTRIES_PER_PLAYER);
+		}
+		else {
+			// The fill advanced every start to the next cell's start; shift back
+			for (int cell = cell_count; cell > 0; --cell) {
+				cell_start[cell] = cell_start[cell - 1];
+			}
+			cell_start[0] = 0;
+		}
+	}
+
+	// Only tested volleys read the clearance
+	if (sim->bullets.active_volleys > 0) {
+		player_grid_build_clearance(grid, sim, reach);
+	}
+}
+
+// NOTE(jakob): Sizes every per-player array for num_players. The arrays only
+// grow.
+static void sim_players_reserve(Sim_State *sim, int num_players) {
+	int old_capacity = sim->player_capacity;
+	if (num_players <= old_capacity) return;
+
+	REALLOC_ARRAY(sim->players, num_players);
+	REALLOC_ARRAY(sim->player_bots, num_players);
+	REALLOC_ARRAY(sim->player_comeback_factor, num_players);
+
+	Player_Grid *grid = &sim->player_grid;
+	REALLOC_ARRAY(grid->player_radius, num_players);
+	REALLOC_ARRAY(grid->player_path, num_players*(MAX_BULLET_TICK_DIVISOR + 1));
+	REALLOC_ARRAY(grid->player_path_min, num_players);
+	REALLOC_ARRAY(grid->player_path_max, num_players);
+	REALLOC_ARRAY(grid->active_tiles, num_players*PLAYER_GRID_TILES_PER_PLAYER);
+	REALLOC_ARRAY(grid->cell_start, num_players*PLAYER_GRID_TILES_PER_PLAYER*PLAYER_GRID_TILE_CELLS + 1);
+	REALLOC_ARRAY(grid->entries, num_players*PLAYER_GRID_ENTRIES_PER_PLAYER);
+
+	Player_Sweep *sweep = &sim->player_sweep;
+	REALLOC_ARRAY(sweep->order, num_players);
+	REALLOC_ARRAY(sweep->min_x, num_players);
+	REALLOC_ARRAY(sweep->max_x, num_players);
+	REALLOC_ARRAY(sweep->y, num_players);
+	REALLOC_ARRAY(sweep->radius, num_players);
+	REALLOC_ARRAY(sweep->pair_sort_counts, num_players + 1);
+
+	Player_Contacts *contacts = &sim->player_contacts;
+	REALLOC_ARRAY(contacts->moved_stamp, num_players);
+	REALLOC_ARRAY(contacts->island_parent, num_players);
+	REALLOC_ARRAY(contacts->island_start, num_players + 1);
+	REALLOC_ARRAY(contacts->island_roots, num_players);
+	REALLOC_ARRAY(contacts->island_settled, num_players);
+	REALLOC_ARRAY(contacts->player_colors, num_players);
+
+	for (int worker_index = 0; worker_index < MAX_WORKERS; ++worker_index) {
+		Player_Grid_Query *query = &sim->bullet_update.workers[worker_index].query;
+		REALLOC_ARRAY(query->stamps, num_players);
+		REALLOC_ARRAY(query->candidates, num_players);
+		memset(query->stamps, 0, (size_t)num_players*sizeof(*query->stamps));
+		query->stamp = 0;
+	}
+
+	sim->player_capacity = num_players;
+
+	for (int player_index = old_capacity; player_index < num_players; ++player_index) {
+		sim->players[player_index] = (Player){0};
+	}
+}
+
+bool sim_is_game_over(Sim_State *sim) {
+	return sim->num_dead_players >= sim->params.num_players - 1;
+}
+
+void sim_reset(Sim_State *sim, const Game_Parameters *params, Sim_Arena arena) {
+
+	// Init game parameters
+	sim->params = *params;
+	sim->arena = arena;
+
+	sim->triumphant_player = -1;
+	sim->num_dead_players = 0;
+	sim->events.count = 0;
+	bullet_pool_release(&sim->bullets);
+	sim->sim_time = 0.0f;
+	sim->tick_count = 0;
+	sim->player_grid.max_player_reach = 0.0f;
+	sim->player_grid.player_travel = 0.0;
+	sim->player_grid.active_tile_count = 0;
+	memset(sim->player_grid.tile_slot, 0xff, sizeof(sim->player_grid.tile_slot));
+
+	Game_Parameters *game_params = &sim->params;
+
+	game_params->num_players = MAXIMUM(2, MINIMUM(game_params->num_players, MAX_LOBBY_PLAYERS));
+	game_params->num_local_players = MAXIMUM(0, MINIMUM(game_params->num_local_players, MINIMUM(game_params->num_players, MAX_LOCAL_PLAYERS)));
+	game_params->bullet_tick_divisor = MAXIMUM(1, MINIMUM(game_params->bullet_tick_divisor, MAX_BULLET_TICK_DIVISOR));
+
+	sim_players_reserve(sim, game_params->num_players);
+
+	sim->lobby_players = 0;
+	if (!sim->generic_lobby && game_params->num_players <= MAX_SMALL_LOBBY_PLAYERS) {
+		sim->lobby_players = game_params->num_players;
+	}
+
+	// NOTE(jakob): Players start in a grid of columns at least two minimum
+	// diameters apart; up to that many players share one row.
+	int max_column_count = MAXIMUM(1, (int)(arena.width/(4.0f*game_params->minimum_radius)));
+	int column_count = MINIMUM(game_params->num_players, max_column_count);
+	int row_count = (game_params->num_players + column_count - 1)/column_count;
+	float column_width = arena.width / (float)column_count;
+	float row_height = arena.height / (float)row_count;
+
+	// Every player starts alive, and the sweep order starts row by row; it is
+	// re-sorted on the first tick
+	entity_set_clear(&sim->entities, game_params->num_players);
+
+	for (int player_index = 0; player_index < game_params->num_players; ++player_index) {
+		entity_add(&sim->entities, player_index, ENTITY_PLAYER);
+		entity_add(&sim->entities, player_index, ENTITY_ALIVE);
+		entity_add(&sim->entities, player_index, player_index < game_params->num_local_players ? ENTITY_LOCAL : ENTITY_BOT);
+		sim->player_sweep.order[player_index] = player_index;
+	}
+
+	sim->player_contacts.count = 0;
+	sim->player_contacts.previous_count = 0;
+
+	for (int player_index = 0; player_index < game_params->num_players; ++player_index) {
+		Player *player = &sim->players[player_index];
+
+		Vector2 screen_center = (Vector2){0.5f*arena.width, 0.5f*arena.height};
+
+		if (entity_has(&sim->entities, player_index, ENTITY_BOT)) {
+			Player_Bot *bot = &sim->player_bots[player_index];
+			*bot = (Player_Bot){0};
+			bot->random_state = 0x9e3779b97f4a7c15ull*(uint64_t)(player_index + 1);
+			bot->target_index = player_index;
+			bot->rest_time = random_01(&bot->random_state);
+		}
+
+		Vector2 aim_dir = Vector2Subtract(screen_center, player->position);
+		aim_dir = Vector2NormalizeOrZero(aim_dir);
+
+		*player = (Player){0};
+		int column = player_index % column_count;
+		int row = player_index / column_count;
+		player->position = (Vector2){ column_width*(column + 0.5f), row_height*(row + 0.5f) };
+		player->shoot_angle = sim_atan2f(aim_dir.y, aim_dir.x);
+
+		// Move players that would start inside an obstacle out of it
+		const Obstacle_Field *obstacles = sim_obstacles(sim);
+		for (int attempt = 0; obstacles && attempt < 8; ++attempt) {
+			Vector2 normal;
+			float clearance = obstacle_field_distance(obstacles, player->position, &normal) - game_params->minimum_radius;
+			if (clearance >= 0.0f) break;
+			player->position = Vector2Add(player->position, Vector2Scale(normal, 1.0f - clearance));
+		}
+		player->health = game_params->starting_health;
+		sim->player_comeback_factor[player_index] = calculate_player_comeback_factor(player, game_params);
+	}
+}
+
+static uint64_t hash_bytes(uint64_t hash, const void *bytes, size_t size) {
+	const unsigned char *byte = bytes;
+	for (size_t i = 0; i < size; ++i) {
+		hash ^= byte[i];
+		hash *= 1099511628211ull; // FNV-1a
+	}
+	return hash;
+}
+
+uint64_t sim_state_hash(Sim_State *sim) {
+	uint64_t hash = 14695981039346656037ull;
+
+	hash = hash_bytes(hash, &sim->sim_time, sizeof(sim->sim_time));
+	hash = hash_bytes(hash, &sim->tick_count, sizeof(sim->tick_count));
+	hash = hash_bytes(hash, &sim->random_state, sizeof(sim->random_state));
+	hash = hash_bytes(hash, &sim->num_dead_players, sizeof(sim->num_dead_players));
+	hash = hash_bytes(hash, &sim->triumphant_player, sizeof(sim->triumphant_player));
+
+	Entity_Query players = entity_query(&sim->entities, ENTITY_MASK(ENTITY_PLAYER), 0);
+	for (int player_index; (player_index = entity_query_next(&players)) >= 0;) {
+		Player *player = sim->players + player_index;
+		hash = hash_bytes(hash, &player->position, sizeof(player->position));
+		hash = hash_bytes(hash, &player->velocity, sizeof(player->velocity));
+		hash = hash_bytes(hash, &player->angular_velocity, sizeof(player->angular_velocity));
+		hash = hash_bytes(hash, &player->shoot_angle, sizeof(player->shoot_angle));
+		hash = hash_bytes(hash, &player->health, sizeof(player->health));
+		hash = hash_bytes(hash, &player->energy, sizeof(player->energy));
+		hash = hash_bytes(hash, &player->shoot_time_out, sizeof(player->shoot_time_out));
+		hash = hash_bytes(hash, &player->shoot_charge_t, sizeof(player->shoot_charge_t));
+
+		if (entity_has(&sim->entities, player_index, ENTITY_BOT)) {
+			Player_Bot *bot = sim->player_bots + player_index;
+			hash = hash_bytes(hash, &bot->random_state, sizeof(bot->random_state));
+			hash = hash_bytes(hash, &bot->target_index, sizeof(bot->target_index));
+			hash = hash_bytes(hash, &bot->charge_time, sizeof(bot->charge_time));
+			hash = hash_bytes(hash, &bot->rest_time, sizeof(bot->rest_time));
+		}
+	}
+
+	Bullet_Pool *bullets = &sim->bullets;
+	size_t volley_count = (size_t)bullets->active_volleys;
+	hash = hash_bytes(hash, &bullets->active_bullets, sizeof(bullets->active_bullets));
+	hash = hash_bytes(hash, &bullets->active_volleys, sizeof(bullets->active_volleys));
+	hash = hash_bytes(hash, bullets->volleys, volley_count*sizeof(*bullets->volleys));
+	hash = hash_bytes(hash, bullets->alive_count, volley_count*sizeof(*bullets->alive_count));
+	hash = hash_bytes(hash, bullets->alive_words, (size_t)bullets->active_words*sizeof(*bullets->alive_words));
+
+	return hash;
+}
+
+void calculate_bullet_count_and_angle_span(Player *player, Game_Parameters *game_params, int *count_out, float *angle_span_out) {
+	float narrow_angle_span = 2.0*PI / 60.0f;
+	float wide_angle_span = 2.0*PI / 4.0f;
+	float t = player->shoot_charge_t;
+	float comeback_factor = calculate_player_comeback_factor(player, game_params);
+	*count_out = (player->energy * (0.25f + 0.75f*comeback_factor)) / game_params->bullet_energy_cost_fan;
+	*angle_span_out = Lerp(wide_angle_span, narrow_angle_span, t);
+}
+
+float shortest_angle_difference(float a, float b) {
+	// NOTE(jakob & patrick): This assumes normalized angles between 0 and 2*PI
+	// assert(a >= 0.0f);
+	// assert(b >= 0.0f);
+	// assert(a <= 2*PI + 0.00001f);
+	// assert(b <= 2*PI + 0.00001f);
+
+	float angle_difference = b - a;
+
+	if (angle_difference > PI) {
+		angle_difference -= 2*PI;
+	} else if (angle_difference < -PI) {
+		angle_difference += 2*PI;
+	}
+
+	return angle_difference;
+}
+
+float lerp_angle(float a, float b, float t) {
+	float difference = shortest_angle_difference(a, b);
+	float result = a + t*difference;
+
+	if (result >= 2*PI) {
+		result -= 2*PI;
+	}
+	else if (result < 0.0f) {
+		result += 2*PI;
+	}
+	return result;
+}
+
+// NOTE(jakob): Stable counting sort of the pairs on one of the player indices
+static void sort_player_pairs_by(Player_Pair *pairs, Player_Pair *scratch, int *counts, int pair_count, int num_players, bool by_first) {
+	memset(counts, 0, (num_players + 1)*sizeof(*counts));
+
+	for (int pair_index = 0; pair_index < pair_count; ++pair_index) {
+		Player_Pair pair = pairs[pair_index];
+		++counts[(by_first ? pair.player_1_index : pair.player_2_index) + 1];
+	}
+
+	for (int player_index = 0; player_index < num_players; ++player_index) {
+		counts[player_index + 1] += counts[player_index];
+	}
+
+	for (int pair_index = 0; pair_index < pair_count; ++pair_index) {
+		Player_Pair pair = pairs[pair_index];
+		scratch[counts[by_first ? pair.player_1_index : pair.player_2_index]++] = pair;
+	}
+
+	memcpy(pairs, scratch, pair_count*sizeof(*pairs));
+}
+
+// NOTE(jakob): Removes ENTITY_ALIVE from the players that died this tick and
+// drops them from the sweep order, which keeps its order.
+static void sim_drop_dead_players(Sim_State *sim) {
+	int order_count = entity_count(&sim->entities, ENTITY_ALIVE);
+
+	Entity_Query living = entity_query(&sim->entities, ENTITY_MASK(ENTITY_ALIVE), 0);
+	for (int player_index; (player_index = entity_query_next(&living)) >= 0;) {
+		if (sim->players[player_index].health <= 0) entity_remove(&sim->entities, player_index, ENTITY_ALIVE);
+	}
+
+	int *order = sim->player_sweep.order;
+	int living_count = 0;
+	for (int order_index = 0; order_index < order_count; ++order_index) {
+		int player_index = order[order_index];
+		if (entity_has(&sim->entities, player_index, ENTITY_ALIVE)) order[living_count++] = player_index;
+	}
+
+	assert(living_count == entity_count(&sim->entities, ENTITY_ALIVE));
+}
+
+static void player_sweep_update(Player_Sweep *sweep, Sim_State *sim, float dt) {
+	int num_players = sim->params.num_players;
+	int living_count = entity_count(&sim->entities, ENTITY_ALIVE);
+
+	Entity_Query living = entity_query(&sim->entities, ENTITY_MASK(ENTITY_ALIVE), 0);
+	for (int player_index; (player_index = entity_query_next(&living)) >= 0;) {
+		Player *player = sim->players + player_index;
+
+		float radius = sweep->radius[player_index];
+		float to_x = player->position.x + player->velocity.x*dt;
+		sweep->min_x[player_index] = to_x - radius;
+		sweep->max_x[player_index] = to_x + radius;
+		sweep->y[player_index] = player->position.y + player->velocity.y*dt;
+	}
+
+	// Insertion sort on min x; near linear since players move little per tick
+	int *order = sweep->order;
+	for (int i = 1; i < living_count; ++i) {
+		int player_index = order[i];
+		float key = sweep->min_x[player_index];
+		int j = i - 1;
+		while (j >= 0 && sweep->min_x[order[j]] > key) {
+			order[j + 1] = order[j];
+			--j;
+		}
+		order[j + 1] = player_index;
+	}
+
+	sweep->pair_count = 0;
+
+	for (int i = 0; i < living_count; ++i) {
+		int player_1_index = order[i];
+
+		float max_x = sweep->max_x[player_1_index];
+		float y = sweep->y[player_1_index];
+		float radius = sweep->radius[player_1_index];
+
+		for (int j = i + 1; j < living_count; ++j) {
+			int player_2_index = order[j];
+			if (sweep->min_x[player_2_index] > max_x) break;
+			if (fabsf(sweep->y[player_2_index] - y) > radius + sweep->radius[player_2_index]) continue;
+
+			if (sweep->pair_count == sweep->pair_capacity) {
+				sweep->pair_capacity = MAXIMUM(64, 2*sweep->pair_capacity);
+				REALLOC_ARRAY(sweep->pairs, sweep->pair_capacity);
+				REALLOC_ARRAY(sweep->pairs_scratch, sweep->pair_capacity);
+			}
+
+			Player_Pair *pair = &sweep->pairs[sweep->pair_count++];
+			pair->player_1_index = MINIMUM(player_1_index, player_2_index);
+			pair->player_2_index = MAXIMUM(player_1_index, player_2_index);
+		}
+	}
+
+	// NOTE(jakob): Pairs are resolved one after another, so keep the same
+	// (lowest index first) order the full pair loop had
+	if (sweep->pair_count > 1) {
+		sort_player_pairs_by(sweep->pairs, sweep->pairs_scratch, sweep->pair_sort_counts, sweep->pair_count, num_players, false);
+		sort_player_pairs_by(sweep->pairs, sweep->pairs_scratch, sweep->pair_sort_counts, sweep->pair_count, num_players, true);
+	}
+}
+
+// NOTE(jakob): Lobbies of 2 to 4 players, the range of local matches, get
+// their own pair and opponent tests with the player count written out: every
+// pair and every opponent is tested by its own copy of the test, and the
+// players' bounds and radii stay in registers. They find the same pairs, hits
+// and order as the sweep and the grid query, which only leave out pairs and
+// opponents that cannot touch. sim_reset picks them by the player count.
+//
+// The rest of the fixed step stays generic. Unrolling its per-player loops
+// for a fixed count measured within noise, since their bodies (steering,
+// shooting, edges) cost far more than walking 2 to 4 players.
+#define SMALL_LOBBY_PAIR(I, J) \
+	if (alive[I] && alive[J] && \
+		min_x[J] <= max_x[I] && min_x[I] <= max_x[J] && \
+		fabsf(y[J] - y[I]) <= radius[I] + radius[J]) \
+	{ \
+		sweep->pairs[pair_count++] = (Player_Pair){I, J}; \
+	}
+
+#define SMALL_LOBBY_PAIRS_FUNCTION(N, PAIRS) \
+static void player_pairs_update_##N(Player_Sweep *sweep, Sim_State *sim, float dt) { \
+	bool alive[N]; \
+	float min_x[N], max_x[N], y[N], radius[N]; \
+	\
+	for (int player_index = 0; player_index < N; ++player_index) { \
+		Player *player = sim->players + player_index; \
+		alive[player_index] = entity_has(&sim->entities, player_index, ENTITY_ALIVE); \
+		radius[player_index] = sweep->radius[player_index]; \
+		float to_x = player->position.x + player->velocity.x*dt; \
+		min_x[player_index] = to_x - radius[player_index]; \
+		max_x[player_index] = to_x + radius[player_index]; \
+		y[player_index] = player->position.y + player->velocity.y*dt; \
+	} \
+	\
+	if (sweep->pair_capacity < N*(N - 1)/2) { \
+		sweep->pair_capacity = MAXIMUM(64, N*(N - 1)/2); \
+		REALLOC_ARRAY(sweep->pairs, sweep->pair_capacity); \
+		REALLOC_ARRAY(sweep->pairs_scratch, sweep->pair_capacity); \
+	} \
+	\
+	int pair_count = 0; \
+	PAIRS \
+	sweep->pair_count = pair_count; \
+}
+
+SMALL_LOBBY_PAIRS_FUNCTION(2,
+	SMALL_LOBBY_PAIR(0, 1)
+)
+
+SMALL_LOBBY_PAIRS_FUNCTION(3,
+	SMALL_LOBBY_PAIR(0, 1) SMALL_LOBBY_PAIR(0, 2)
+	SMALL_LOBBY_PAIR(1, 2)
+)
+
+SMALL_LOBBY_PAIRS_FUNCTION(4,
+	SMALL_LOBBY_PAIR(0, 1) SMALL_LOBBY_PAIR(0, 2) SMALL_LOBBY_PAIR(0, 3)
+	SMALL_LOBBY_PAIR(1, 2) SMALL_LOBBY_PAIR(1, 3)
+	SMALL_LOBBY_PAIR(2, 3)
+)
+
+#undef SMALL_LOBBY_PAIRS_FUNCTION
+#undef SMALL_LOBBY_PAIR
+
+// NOTE(jakob): Finds the pairs of players that may touch this tick, in pair order
+static void player_pairs_update(Player_Sweep *sweep, Sim_State *sim, float dt) {
+	switch (sim->lobby_players) {
+		case 2: player_pairs_update_2(sweep, sim, dt); break;
+		case 3: player_pairs_update_3(sweep, sim, dt); break;
+		case 4: player_pairs_update_4(sweep, sim, dt); break;
+		default: player_sweep_update(sweep, sim, dt); break;
+	}
+}
+
+static int player_island_find(int *parent, int player_index) {
+	while (parent[player_index] != player_index) {
+		parent[player_index] = parent[parent[player_index]];
+		player_index = parent[player_index];
+	}
+	return player_index;
+}
+
+// NOTE(jakob): Turns this tick's sweep pairs into contacts, carrying over the
+// push of pairs that were already in contact last tick, and groups them into
+// islands and colors. Both lists are sorted by pair, so matching them is one
+// merge.
+static void player_contacts_update(Player_Contacts *contacts, Player_Sweep *sweep, int num_players) {
+	Player_Contact *swap = contacts->previous;
+	contacts->previous = contacts->contacts;
+	contacts->contacts = swap;
+	contacts->previous_count = contacts->count;
+
+	if (sweep->pair_count > contacts->capacity) {
+		contacts->capacity = sweep->pair_capacity;
+		REALLOC_ARRAY(contacts->contacts, contacts->capacity);
+		REALLOC_ARRAY(contacts->previous, contacts->capacity);
+		REALLOC_ARRAY(contacts->island_contacts, contacts->capacity);
+		REALLOC_ARRAY(contacts->color_contacts, contacts->capacity);
+	}
+
+	contacts->count = sweep->pair_count;
+
+	int *parent = contacts->island_parent;
+	for (int player_index = 0; player_index < num_players; ++player_index) {
+		parent[player_index] = player_index;
+	}
+
+	int previous_index = 0;
+
+	for (int contact_index = 0; contact_index < contacts->count; ++contact_index) {
+		Player_Pair pair = sweep->pairs[contact_index];
+		Player_Contact *contact = &contacts->contacts[contact_index];
+
+		contact->player_1_index = pair.player_1_index;
+		contact->player_2_index = pair.player_2_index;
+		contact->impulse = 0.0f;
+		contact->rings = 0;
+
+		while (previous_index < contacts->previous_count) {
+			Player_Contact *previous = &contacts->previous[previous_index];
+			if (previous->player_1_index > pair.player_1_index) break;
+			if (previous->player_1_index == pair.player_1_index && previous->player_2_index >= pair.player_2_index) {
+				if (previous->player_2_index == pair.player_2_index) {
+					contact->impulse = PLAYER_CONTACT_WARM_START*previous->impulse;
+				}
+				break;
+			}
+			++previous_index;
+		}
+
+		int root_1 = player_island_find(parent, pair.player_1_index);
+		int root_2 = player_island_find(parent, pair.player_2_index);
+		parent[MAXIMUM(root_1, root_2)] = MINIMUM(root_1, root_2);
+	}
+
+	// Counting sort of the contacts by island; stable, so each island keeps the pair order
+	int *island_start = contacts->island_start;
+	memset(island_start, 0, (num_players + 1)*sizeof(*island_start));
+
+	for (int contact_index = 0; contact_index < contacts->count; ++contact_index) {
+		Player_Contact *contact = &contacts->contacts[contact_index];
+		contact->island = player_island_find(parent, contact->player_1_index);
+		++island_start[contact->island + 1];
+	}
+
+	contacts->island_count = 0;
+
+	for (int player_index = 0; player_index < num_players; ++player_index) {
+		if (island_start[player_index + 1] > 0) {
+			contacts->island_roots[contacts->island_count++] = player_index;
+		}
+		island_start[player_index + 1] += island_start[player_index];
+	}
+
+	for (int contact_index = 0; contact_index < contacts->count; ++contact_index) {
+		contacts->island_contacts[island_start[contacts->contacts[contact_index].island]++] = contact_index;
+	}
+
+	// The fill moved each start to the next island's start; shift them back
+	memmove(island_start + 1, island_start, num_players*sizeof(*island_start));
+	island_start[0] = 0;
+
+	// Greedy coloring: each contact takes the lowest color that neither of its players has yet
+	uint64_t *player_colors = contacts->player_colors;
+	int *color_start = contacts->color_start;
+	memset(color_start, 0, sizeof(contacts->color_start));
+
+	for (int contact_index = 0; contact_index < contacts->count; ++contact_index) {
+		Player_Contact *contact = &contacts->contacts[contact_index];
+		player_colors[contact->player_1_index] = 0;
+		player_colors[contact->player_2_index] = 0;
+	}
+
+	for (int contact_index = 0; contact_index < contacts->count; ++contact_index) {
+		Player_Contact *contact = &contacts->contacts[contact_index];
+		uint64_t used = player_colors[contact->player_1_index] | player_colors[contact->player_2_index];
+
+		int color = 0;
+		while (color < PLAYER_CONTACT_MAX_COLORS && (used >> color) & 1) ++color;
+
+		if (color < PLAYER_CONTACT_MAX_COLORS) {
+			player_colors[contact->player_1_index] |= (uint64_t)1 << color;
+			player_colors[contact->player_2_index] |= (uint64_t)1 << color;
+		}
+
+		contact->color = color;
+		++color_start[color + 1];
+	}
+
+	contacts->color_count = 0;
+
+	for (int color = 0; color <= PLAYER_CONTACT_MAX_COLORS; ++color) {
+		if (color_start[color + 1] > 0) contacts->color_count = color + 1;
+		color_start[color + 1] += color_start[color];
+	}
+
+	for (int contact_index = 0; contact_index < contacts->count; ++contact_index) {
+		Player_Contact *contact = &contacts->contacts[contact_index];
+		contacts->color_contacts[color_start[contact->color]++] = contact_index;
+	}
+
+	memmove(color_start + 1, color_start, (PLAYER_CONTACT_MAX_COLORS + 1)*sizeof(*color_start));
+	color_start[0] = 0;
+}
+
+// NOTE(jakob): Resolves one contact: projects the end-of-tick positions apart
+// and, on the first iteration of a tick, exchanges the normal velocities
+// elastically if the players touch while closing in. Later iterations only
+// move positions, so the velocities an island converges against stay put.
+// Only touches the contact and its two players, so contacts of one color can
+// be solved in parallel; rings are flagged for player_contact_batch_rings.
+// Returns how far the push moved the players.
+static float player_contact_solve(Sim_State *sim, Player_Contact *contact, uint32_t stamp, float dt, bool bounce) {
+	Player_Sweep *sweep = &sim->player_sweep;
+	Player_Contacts *contacts = &sim->player_contacts;
+
+	contact->solved_stamp = stamp;
+
+	int player_1_index = contact->player_1_index;
+	int player_2_index = contact->player_2_index;
+
+	Player *player1 = sim->players + player_1_index;
+	Player *player2 = sim->players + player_2_index;
+
+	Vector2 player1_to_position = Vector2Add(player1->position, Vector2Scale(player1->velocity, dt));
+	Vector2 player2_to_position = Vector2Add(player2->position, Vector2Scale(player2->velocity, dt));
+
+	float player1_radius = sweep->radius[player_1_index];
+	float player2_radius = sweep->radius[player_2_index];
+
+	float radii_sum = player2_radius + player1_radius;
+
+	Vector2 position_difference = Vector2Subtract(player2_to_position, player1_to_position);
+	float distance = Vector2Length(position_difference);
+	float separation = distance - radii_sum;
+
+	// Apart, and not pushed apart earlier this tick
+	if (separation > 0.0f && contact->impulse == 0.0f) return 0.0f;
+	if (distance == 0.0f) return 0.0f;
+
+	float inv_distance = 1.0f/distance;
+	Vector2 normal = Vector2Scale(position_difference, inv_distance);
+
+	// Static collision
+	float impulse = MAXIMUM(contact->impulse - separation, 0.0f);
+	float push = impulse - contact->impulse;
+	contact->impulse = impulse;
+
+	if (push != 0.0f) {
+		player1->position = Vector2Add(player1->position, Vector2Scale(normal, -0.5f*push));
+		player2->position = Vector2Add(player2->position, Vector2Scale(normal, 0.5f*push));
+	}
+
+	if (fabsf(push) >= PLAYER_CONTACT_TOLERANCE) {
+		contacts->moved_stamp[player_1_index] = stamp;
+		contacts->moved_stamp[player_2_index] = stamp;
+	}
+
+	// Dynamic collision
+	float normal_response_1 = Vector2DotProduct(normal, player1->velocity);
+	float normal_response_2 = Vector2DotProduct(normal, player2->velocity);
+
+	if (bounce && separation <= 0.0f && normal_response_1 > normal_response_2) {
+		Vector2 tangent = (Vector2){normal.y, -normal.x};
+
+		float tangental_response_1 = Vector2DotProduct(tangent, player1->velocity);
+		float tangental_response_2 = Vector2DotProduct(tangent, player2->velocity);
+
+		float mass_1 = player1_radius;
+		float mass_2 = player2_radius;
+
+		float momentum_1 = (normal_response_1 * (mass_1 - mass_2) + 2.0f * mass_2 * normal_response_2) / (mass_1 + mass_2);
+		float momentum_2 = (normal_response_2 * (mass_2 - mass_1) + 2.0f * mass_1 * normal_response_1) / (mass_1 + mass_2);
+
+		player1->velocity = Vector2Add(
+			Vector2Scale(tangent, tangental_response_1),
+			Vector2Scale(normal, momentum_1)
+		);
+
+		player2->velocity = Vector2Add(
+			Vector2Scale(tangent, tangental_response_2),
+			Vector2Scale(normal, momentum_2)
+		);
+
+		contacts->moved_stamp[player_1_index] = stamp;
+		contacts->moved_stamp[player_2_index] = stamp;
+
+		contact->rings = (hit_is_hard_enough(normal_response_1) ? 1 : 0) | (hit_is_hard_enough(normal_response_2) ? 2 : 0);
+	}
+
+	return fabsf(push);
+}
+
+// NOTE(jakob): Applies the carried push along the current normal
+static void player_contact_warm_start(Sim_State *sim, Player_Contact *contact, float dt) {
+	if (contact->impulse == 0.0f) return;
+
+	Player *player1 = sim->players + contact->player_1_index;
+	Player *player2 = sim->players + contact->player_2_index;
+	Vector2 relative_velocity = Vector2Subtract(player2->velocity, player1->velocity);
+	Vector2 position_difference = Vector2Add(Vector2Subtract(player2->position, player1->position), Vector2Scale(relative_velocity, dt));
+	Vector2 normal = Vector2NormalizeOrZero(position_difference);
+
+	player1->position = Vector2Add(player1->position, Vector2Scale(normal, -0.5f*contact->impulse));
+	player2->position = Vector2Add(player2->position, Vector2Scale(normal, 0.5f*contact->impulse));
+}
+
+typedef struct Player_Contact_Batch {
+	Sim_State *sim;
+	float dt;
+	int iteration; // -1 for the warm start
+	int begin; // Of color_contacts
+	int end;
+	int solves[MAX_WORKERS];
+	int skipped[MAX_WORKERS];
+} Player_Contact_Batch;
+
+static void player_contact_batch_worker(void *user_data, int worker_index, int worker_count) {
+	Player_Contact_Batch *batch = user_data;
+	Sim_State *sim = batch->sim;
+	Player_Contacts *contacts = &sim->player_contacts;
+	int iteration = batch->iteration;
+
+	int batch_size = batch->end - batch->begin;
+	int begin = batch->begin + batch_size*worker_index/worker_count;
+	int end = batch->begin + batch_size*(worker_index + 1)/worker_count;
+
+	int solves = 0;
+	int skipped = 0;
+
+	for (int color_index = begin; color_index < end; ++color_index) {
+		Player_Contact *contact = &contacts->contacts[contacts->color_contacts[color_index]];
+
+		if (iteration < 0) {
+			player_contact_warm_start(sim, contact, batch->dt);
+			continue;
+		}
+
+		contact->push = 0.0f;
+
+		if (contacts->island_settled[contact->island]) continue;
+
+		if (iteration > 0 &&
+			contacts->moved_stamp[contact->player_1_index] <= contact->solved_stamp &&
+			contacts->moved_stamp[contact->player_2_index] <= contact->solved_stamp
+		) {
+			++skipped;
+			continue;
+		}
+
+		// Stamps follow the solve order, which is the same for any worker count
+		uint32_t stamp = (uint32_t)(iteration*contacts->count + color_index + 1);
+		contact->push = player_contact_solve(sim, contact, stamp, batch->dt, iteration == 0);
+		++solves;
+	}
+
+	batch->solves[worker_index] = solves;
+	batch->skipped[worker_index] = skipped;
+}
+
+// NOTE(jakob): Spawns the rings that the bounces of a batch set off, in
+// contact order. The players of a batch are disjoint, so this is what solving
+// the batch on one thread would have done.
+static void player_contact_batch_rings(Sim_State *sim, int begin, int end) {
+	Player_Contacts *contacts = &sim->player_contacts;
+	Player_Sweep *sweep = &sim->player_sweep;
+
+	for (int color_index = begin; color_index < end; ++color_index) {
+		Player_Contact *contact = &contacts->contacts[contacts->color_contacts[color_index]];
+		if (!contact->rings) continue;
+
+		if (contact->rings & 1) {
+			spawn_bullet_ring(sim->players + contact->player_1_index, sim);
+			sweep->radius[contact->player_1_index] = calculate_player_radius(sim->players + contact->player_1_index, &sim->params);
+		}
+
+		if (contact->rings & 2) {
+			spawn_bullet_ring(sim->players + contact->player_2_index, sim);
+			sweep->radius[contact->player_2_index] = calculate_player_radius(sim->players + contact->player_2_index, &sim->params);
+		}
+
+		contact->rings = 0;
+	}
+}
+
+// NOTE(jakob): Runs one pass over every color in order, each split across as
+// many workers as it has MIN_CONTACTS_PER_WORKER contacts for
+static void player_contacts_pass(Sim_State *sim, int iteration, float dt) {
+	Player_Contacts *contacts = &sim->player_contacts;
+	Collision_Stats *stats = &sim->collision_stats;
+
+	for (int color = 0; color < contacts->color_count; ++color) {
+		Player_Contact_Batch batch = {
+			.sim = sim,
+			.dt = dt,
+			.iteration = iteration,
+			.begin = contacts->color_start[color],
+			.end = contacts->color_start[color + 1],
+		};
+
+		int batch_size = batch.end - batch.begin;
+		if (batch_size == 0) continue;
+
+		int worker_count = 1;
+		if (color < PLAYER_CONTACT_MAX_COLORS) {
+			worker_count = MAXIMUM(1, MINIMUM(sim->workers.worker_count, batch_size/MIN_CONTACTS_PER_WORKER));
+		}
+
+		worker_pool_run(&sim->workers, player_contact_batch_worker, &batch, worker_count);
+
+		for (int worker_index = 0; worker_index < worker_count; ++worker_index) {
+			stats->player_contact_solves += batch.solves[worker_index];
+			stats->player_contact_solves_skipped += batch.skipped[worker_index];
+		}
+
+		if (iteration == 0) {
+			player_contact_batch_rings(sim, batch.begin, batch.end);
+		}
+	}
+}
+
+static void player_contacts_solve(Sim_State *sim, float dt) {
+	Player_Contacts *contacts = &sim->player_contacts;
+	Collision_Stats *stats = &sim->collision_stats;
+	int num_players = sim->params.num_players;
+
+	stats->player_contacts = contacts->count;
+	stats->player_islands = contacts->island_count;
+	stats->player_contact_colors = contacts->color_count;
+	stats->player_solver_iterations = 0;
+	stats->player_contact_solves = 0;
+	stats->player_contact_solves_skipped = 0;
+
+	if (contacts->count == 0) return;
+
+	memset(contacts->moved_stamp, 0, (size_t)num_players*sizeof(*contacts->moved_stamp));
+
+	for (int island_index = 0; island_index < contacts->island_count; ++island_index) {
+		contacts->island_settled[contacts->island_roots[island_index]] = false;
+	}
+
+	player_contacts_pass(sim, -1, dt);
+
+	// The islands that have not settled yet are kept at the front of island_roots
+	int active_island_count = contacts->island_count;
+
+	for (int iteration = 0; iteration < PLAYER_CONTACT_MAX_ITERATIONS && active_island_count > 0; ++iteration) {
+		player_contacts_pass(sim, iteration, dt);
+
+		int still_active_count = 0;
+
+		for (int island_index = 0; island_index < active_island_count; ++island_index) {
+			int root = contacts->island_roots[island_index];
+			int begin = contacts->island_start[root];
+			int end = contacts->island_start[root + 1];
+
+			float largest_push = 0.0f;
+			for (int contact_index = begin; contact_index < end; ++contact_index) {
+				largest_push = MAXIMUM(largest_push, contacts->contacts[contacts->island_contacts[contact_index]].push);
+			}
+
+			if (largest_push < PLAYER_CONTACT_TOLERANCE || iteration + 1 == PLAYER_CONTACT_MAX_ITERATIONS) {
+				contacts->island_settled[root] = true;
+				stats->player_solver_iterations += iteration + 1;
+				stats->player_contact_solves_skipped += (PLAYER_CONTACT_MAX_ITERATIONS - iteration - 1)*(end - begin);
+			}
+			else {
+				contacts->island_roots[still_active_count++] = root;
+			}
+		}
+
+		active_island_count = still_active_count;
+	}
+}
+
+// NOTE(jakob): Fraction of the move from -> to done before reaching contact
+static float edge_time_of_impact(float from, float to, float contact) {
+	float motion = to - from;
+	if (motion == 0.0f) return 0.0f;
+	float t = (contact - from)/motion;
+	return MAXIMUM(0.0f, MINIMUM(t, 1.0f));
+}
+
+// NOTE(jakob): Collects the players listed in the cells overlapped by the
+// motion from -> to, each once and in ascending index order
+static int player_grid_query(Player_Grid *grid, Player_Grid_Query *query, int player_capacity, Vector2 from, Vector2 to) {
+
+	if (++query->stamp == 0) {
+		memset(query->stamps, 0, player_capacity*sizeof(*query->stamps));
+		query->stamp = 1;
+	}
+
+	int *candidates_out = query->candidates;
+
+	int min_x = player_grid_cell_coordinate(grid, MINIMUM(from.x, to.x), grid->columns);
+	int max_x = player_grid_cell_coordinate(grid, MAXIMUM(from.x, to.x), grid->columns);
+	int min_y = player_grid_cell_coordinate(grid, MINIMUM(from.y, to.y), grid->rows);
+	int max_y = player_grid_cell_coordinate(grid, MAXIMUM(from.y, to.y), grid->rows);
+
+	int count = 0;
+
+	for (int y = min_y; y <= max_y; ++y) {
+		for (int x = min_x; x <= max_x; ++x) {
+			int cell = player_grid_cell(grid, x, y);
+			if (cell < 0) continue;
+
+			for (int entry_index = grid->cell_start[cell]; entry_index < grid->cell_start[cell + 1]; ++entry_index) {
+				int player_index = grid->entries[entry_index];
+				if (query->stamps[player_index] == query->stamp) continue;
+				query->stamps[player_index] = query->stamp;
+
+				int insert_index = count++;
+				while (insert_index > 0 && candidates_out[insert_index - 1] > player_index) {
+					candidates_out[insert_index] = candidates_out[insert_index - 1];
+					--insert_index;
+				}
+				candidates_out[insert_index] = player_index;
+			}
+		}
+	}
+
+	return count;
+}
+
+// NOTE(jakob): The farthest a bullet of the volley can move in one tick
+static double bullet_volley_max_step(const Bullet_Volley *volley) {
+	double base_speed = sqrt((double)volley->base_vx*volley->base_vx + (double)volley->base_vy*volley->base_vy);
+	return ((double)volley->speed + base_speed)*TIME_STEP_FIXED;
+}
+
+// NOTE(jakob): Conservative advancement. When a volley is tested on bullet
+// tick t0, which ends a window of D = bullet_tick_divisor ticks, each live
+// lane has some clearance from where it started the window to the playzone
+// edge and to the reach of every living player, and the smallest one minus a
+// margin is the volley's clearance. Until the volley's bullets have moved
+// farther than that, plus however far the players moved and grew meanwhile,
+// none of its bullets can hit anything or leave the playzone, so it is not
+// evaluated or tested:
+//
+//   max_step*(t - t0 + D) + player_travel(t) - player_travel(t0) < clearance
+//
+// The terms of t0 are folded into the volley's wake key when it is tested.
+static bool bullet_volley_asleep(Bullet_Pool *bullets, int volley_index, uint32_t tick, double player_travel) {
+	double max_step = bullet_volley_max_step(&bullets->volleys[volley_index]);
+	return max_step*(double)tick + player_travel < bullets->wake_key[volley_index];
+}
+
+// NOTE(jakob): One live bullet's motion this bullet window, for the opponent
+// tests. A volley that was fired or expired during the window only moved in
+// tick_count of its ticks, starting first_tick into it.
+typedef struct Bullet_Test {
+	int volley_index;
+	int lane;
+	int owner;
+	Vector2 from;
+	Vector2 velocity;
+	Vector2 motion;
+	float obstacle_t; // Hits after the bullet stops at an obstacle do not count
+	int first_tick;
+	int tick_count;
+	float tick_fraction; // 1/tick_count
+	Vector2 tick_motion; // motion*tick_fraction
+} Bullet_Test;
+
+static void bullet_worker_push_hit(Bullet_Worker *worker, const Bullet_Test *bullet, int opponent_index, Vector2 bullet_position, Vector2 opponent_position) {
+	if (worker->hit_count == worker->hit_capacity) {
+		worker->hit_capacity = MAXIMUM(256, 2*worker->hit_capacity);
+		REALLOC_ARRAY(worker->hits, worker->hit_capacity);
+	}
+
+	Bullet_Hit *hit = &worker->hits[worker->hit_count++];
+	hit->volley_index = bullet->volley_index;
+	hit->lane = bullet->lane;
+	hit->opponent_index = opponent_index;
+	hit->bullet_speed = Vector2Length(bullet->velocity);
+	hit->bullet_position = bullet_position;
+	hit->opponent_position = opponent_position;
+}
+
+// NOTE(jakob): The swept test of one bullet against one opponent. Records the
+// hit and returns whether there was one.
+static bool bullet_test_opponent(Sim_State *sim, Bullet_Worker *worker, const Bullet_Test *bullet, int opponent_index, float opponent_radius) {
+	const Vector2 *path = player_grid_path(&sim->player_grid, opponent_index) + bullet->first_tick;
+	float radii_sum = sim->params.bullet_radius + opponent_radius;
+
+	// NOTE(jakob): The bullet's motion is split evenly over the ticks it
+	// moved in, and each part is swept against the opponent's motion in that
+	// tick, so an opponent that bounced off an edge, an obstacle or another
+	// player within the window is tested where it actually was
+	if (bullet->tick_count > 1) {
+		// Most bullets pass wide of the opponent; one sweep against a circle
+		// around the box of its path rules them out
+		Vector2 path_min = sim->player_grid.player_path_min[opponent_index];
+		Vector2 path_max = sim->player_grid.player_path_max[opponent_index];
+		Vector2 center = Vector2Scale(Vector2Add(path_min, path_max), 0.5f);
+		float bound = radii_sum + 0.5f*Vector2Length(Vector2Subtract(path_max, path_min)) + 1.0f;
+		if (circle_sweep_time_of_impact(Vector2Subtract(bullet->from, center), bullet->motion, bound) < 0.0f) return false;
+	}
+
+	float tick_fraction = bullet->tick_fraction;
+	Vector2 bullet_motion = bullet->tick_motion;
+
+	for (int step = 0; step < bullet->tick_count; ++step) {
+		Vector2 bullet_from = step == 0 ? bullet->from : Vector2Add(bullet->from, Vector2Scale(bullet->motion, (float)step*tick_fraction));
+		Vector2 opponent_from = path[step];
+		Vector2 opponent_motion = Vector2Subtract(path[step + 1], opponent_from);
+
+		float impact_t = circle_sweep_time_of_impact(
+			Vector2Subtract(bullet_from, opponent_from),
+			Vector2Subtract(bullet_motion, opponent_motion),
+			radii_sum
+		);
+
+		if (!(impact_t >= 0.0f)) continue;
+
+		// The later ticks can only hit later
+		if (!(((float)step + impact_t)*tick_fraction <= bullet->obstacle_t)) return false;
+
+		bullet_worker_push_hit(worker, bullet, opponent_index,
+			Vector2Add(bullet_from, Vector2Scale(bullet_motion, impact_t)),
+			Vector2Add(opponent_from, Vector2Scale(opponent_motion, impact_t))
+		);
+		return true;
+	}
+
+	return false;
+}
+
+typedef int (* Bullet_Opponents_Test)(Sim_State *sim, Bullet_Worker *worker, const Bullet_Test *bullet, bool *hit_out);
+
+// NOTE(jakob): Tests the bullet against the opponents the grid lists near its
+// motion, in index order. Returns how many were tested.
+static int bullet_test_opponents_grid(Sim_State *sim, Bullet_Worker *worker, const Bullet_Test *bullet, bool *hit_out) {
+	Player_Grid *grid = &sim->player_grid;
+	int tested_opponents = 0;
+
+	int *candidates = worker->query.candidates;
+	int candidate_count = player_grid_query(grid, &worker->query, sim->player_capacity, bullet->from, Vector2Add(bullet->from, bullet->motion));
+
+	for (int candidate_index = 0; candidate_index < candidate_count; ++candidate_index) {
+		int opponent_index = candidates[candidate_index];
+		if (opponent_index == bullet->owner) continue;
+
+		// The grid only lists players that were alive this tick
+		++tested_opponents;
+
+		if (bullet_test_opponent(sim, worker, bullet, opponent_index, grid->player_radius[opponent_index])) {
+			*hit_out = true;
+		}
+	}
+
+	return tested_opponents;
+}
+
+#define SMALL_LOBBY_OPPONENT(I) \
+	if (I != bullet->owner && entity_has(&sim->entities, I, ENTITY_ALIVE)) { \
+		++tested_opponents; \
+		if (bullet_test_opponent(sim, worker, bullet, I, radius[I])) *hit_out = true; \
+	}
+
+#define SMALL_LOBBY_OPPONENTS_FUNCTION(N, OPPONENTS) \
+static int bullet_test_opponents_##N(Sim_State *sim, Bullet_Worker *worker, const Bullet_Test *bullet, bool *hit_out) { \
+	const float *radius = sim->player_grid.player_radius; \
+	int tested_opponents = 0; \
+	OPPONENTS \
+	return tested_opponents; \
+}
+
+SMALL_LOBBY_OPPONENTS_FUNCTION(2, SMALL_LOBBY_OPPONENT(0) SMALL_LOBBY_OPPONENT(1))
+SMALL_LOBBY_OPPONENTS_FUNCTION(3, SMALL_LOBBY_OPPONENT(0) SMALL_LOBBY_OPPONENT(1) SMALL_LOBBY_OPPONENT(2))
+SMALL_LOBBY_OPPONENTS_FUNCTION(4, SMALL_LOBBY_OPPONENT(0) SMALL_LOBBY_OPPONENT(1) SMALL_LOBBY_OPPONENT(2) SMALL_LOBBY_OPPONENT(3))
+
+#undef SMALL_LOBBY_OPPONENTS_FUNCTION
+#undef SMALL_LOBBY_OPPONENT
+
+// NOTE(jakob): NULL for the grid, which the worker calls directly so that it
+// can be inlined into the lane loop
+static Bullet_Opponents_Test bullet_small_lobby_opponents_test(int lobby_players) {
+	switch (lobby_players) {
+		case 2: return bullet_test_opponents_2;
+		case 3: return bullet_test_opponents_3;
+		case 4: return bullet_test_opponents_4;
+		default: return NULL;
+	}
+}
+
+static void bullet_update_worker(void *user_data, int worker_index, int worker_count) {
+	Bullet_Update *update = user_data;
+	Sim_State *sim = update->sim;
+	Game_Parameters *game_params = &sim->params;
+	Bullet_Pool *bullets = &sim->bullets;
+	Player_Grid *grid = &sim->player_grid;
+	Bullet_Worker *worker = &update->workers[worker_index];
+	Sim_Arena arena = sim->arena;
+	const Obstacle_Field *obstacles = sim_obstacles(sim);
+
+	const float dt = TIME_STEP_FIXED;
+
+	// The ranges were split by bullet_update_split for update->worker_count workers
+	assert(worker_count == update->worker_count);
+	UNUSED(worker_count);
+
+	int volley_begin = update->worker_volley_begin[worker_index];
+	int volley_end = update->worker_volley_begin[worker_index + 1];
+
+	worker->stats = (Collision_Stats){0};
+	worker->hit_count = 0;
+
+	float bullet_radius = game_params->bullet_radius;
+	uint32_t tick = sim->tick_count;
+	int divisor = game_params->bullet_tick_divisor;
+	uint32_t window_begin = update->window_begin;
+	uint32_t window_end = tick + 1;
+
+	// NOTE(jakob): The live lanes of a volley are evaluated on their arcs 64
+	// at a time, one alive word, into scratch that stays in L1
+	float block_x[64], block_y[64], block_vx[64], block_vy[64];
+	Bullet_Arc_States block = {block_x, block_y, block_vx, block_vy};
+	float end_x[64], end_y[64], end_vx[64], end_vy[64];
+	Bullet_Arc_States end_block = {end_x, end_y, end_vx, end_vy};
+	Bullet_Arc_Kernel arc_kernel = bullet_arc_kernel();
+	Bullet_Opponents_Test test_opponents = bullet_small_lobby_opponents_test(sim->lobby_players);
+
+	// NOTE(jakob): Hits are found with a swept test of each bullet's motion
+	// this bullet window against each nearby opponent's motion in it, so fast
+	// bullets cannot tunnel through players even with a coarse step. Over a
+	// window of several ticks the bullet sweeps the chord of its arc, which
+	// is within a fraction of a pixel of it at bullet spins.
+	for (int volley_index = volley_begin; volley_index < volley_end; ++volley_index) {
+		if (bullet_volley_asleep(bullets, volley_index, tick, grid->player_travel)) {
+			worker->stats.bullet_checks_skipped += bullets->alive_count[volley_index];
+			continue;
+		}
+
+		Bullet_Volley *volley = &bullets->volleys[volley_index];
+		const uint64_t *alive_words = bullet_pool_alive_words(bullets, volley_index);
+
+		uint32_t begin_tick = MAXIMUM(window_begin, volley->spawn_tick);
+		uint32_t end_tick = MINIMUM(window_end, volley->spawn_tick + update->lifetime_ticks);
+		assert(begin_tick < end_tick);
+		bool last_window = end_tick < window_end;
+
+		int player_index = volley->owner;
+		int candidate_opponents = entity_count(&sim->entities, ENTITY_ALIVE) - entity_has(&sim->entities, player_index, ENTITY_ALIVE);
+		float volley_clearance = INFINITY;
+
+		for (int first_lane = 0; first_lane < volley->count; first_lane += 64) {
+			uint64_t alive = alive_words[first_lane/64];
+			if (!alive) continue;
+
+			int lane_count = MINIMUM(64, volley->count - first_lane);
+			arc_kernel(volley, first_lane, lane_count, begin_tick, block);
+			if (divisor > 1) arc_kernel(volley, first_lane, lane_count, end_tick, end_block);
+
+			for (uint64_t lanes = alive; lanes; lanes &= lanes - 1) {
+				int block_index = bits_lowest(lanes);
+				int lane = first_lane + block_index;
+
+				Vector2 bullet_from = (Vector2){block_x[block_index], block_y[block_index]};
+				Vector2 bullet_velocity = (Vector2){block_vx[block_index], block_vy[block_index]};
+				Vector2 bullet_motion, bullet_to;
+
+				if (divisor > 1) {
+					bullet_to = (Vector2){end_x[block_index], end_y[block_index]};
+					bullet_motion = Vector2Subtract(bullet_to, bullet_from);
+				}
+				else {
+					bullet_motion = Vector2Scale(bullet_velocity, dt);
+					bullet_to = Vector2Add(bullet_from, bullet_motion);
+				}
+
+				if (position_outside_playzone(bullet_to, arena)) {
+					bullet_pool_kill_lane(bullets, volley_index, lane);
+					continue;
+				}
+
+				++worker->stats.bullet_checks;
+				volley_clearance = MINIMUM(volley_clearance, player_grid_clearance(grid, arena, bullet_from));
+
+				// NOTE(jakob): A bullet stops at an obstacle when it ends the
+				// window in contact with one; the contact time is interpolated
+				// from the two distances, so only hits before it count. The
+				// field's distance changes by at most sqrt(2) times the distance
+				// moved, which makes it a clearance for conservative advancement.
+				float obstacle_t = INFINITY;
+
+				if (obstacles) {
+					float obstacle_distance = obstacle_field_distance(obstacles, bullet_to, NULL);
+
+					if (obstacle_distance < bullet_radius) {
+						float from_distance = obstacle_field_distance(obstacles, bullet_from, NULL);
+						obstacle_t = from_distance > bullet_radius ? (from_distance - bullet_radius)/(from_distance - obstacle_distance) : 0.0f;
+					}
+
+					volley_clearance = MINIMUM(volley_clearance, (obstacle_distance - bullet_radius)*INV_SQRT_TWO);
+				}
+
+				Bullet_Test bullet = {
+					.volley_index = volley_index,
+					.lane = lane,
+					.owner = player_index,
+					.from = bullet_from,
+					.velocity = bullet_velocity,
+					.motion = bullet_motion,
+					.obstacle_t = obstacle_t,
+					.first_tick = (int)(begin_tick - window_begin),
+					.tick_count = (int)(end_tick - begin_tick),
+				};
+				bullet.tick_fraction = 1.0f/(float)bullet.tick_count;
+				bullet.tick_motion = Vector2Scale(bullet_motion, bullet.tick_fraction);
+
+				bool hit_opponent = false;
+				int tested_opponents = test_opponents ?
+					test_opponents(sim, worker, &bullet, &hit_opponent) :
+					bullet_test_opponents_grid(sim, worker, &bullet, &hit_opponent);
+
+				worker->stats.bullet_pair_tests += tested_opponents;
+				worker->stats.bullet_pair_tests_skipped += MAXIMUM(candidate_opponents - tested_opponents, 0);
+
+				if (obstacle_t <= 1.0f && !hit_opponent) {
+					bullet_pool_kill_lane(bullets, volley_index, lane);
+					++worker->stats.bullets_stopped_by_obstacles;
+				}
+				else if (last_window) {
+					// NOTE(jakob): It took its last step, so it cannot cancel
+					// out at the end of the window
+					bullet_pool_kill_lane(bullets, volley_index, lane);
+				}
+			}
+		}
+
+		double max_step = bullet_volley_max_step(volley);
+		bullets->wake_key[volley_index] = (double)(volley_clearance - BULLET_WAKE_MARGIN) + grid->player_travel + max_step*((double)tick - (double)divisor);
+	}
+}
+
+// NOTE(jakob): Picks the worker count for the awake bullets and splits the
+// volleys into contiguous ranges with about as many awake bullets each
+static void bullet_update_split(Bullet_Update *update, Bullet_Pool *bullets, int max_workers, uint32_t tick, double player_travel) {
+	int64_t total_bullets = 0;
+
+	for (int volley_index = 0; volley_index < update->volley_count; ++volley_index) {
+		if (bullet_volley_asleep(bullets, volley_index, tick, player_travel)) continue;
+		total_bullets += bullets->alive_count[volley_index];
+	}
+
+	update->worker_count = (int)MAXIMUM(1, MINIMUM(max_workers, total_bullets/MIN_BULLETS_PER_WORKER));
+
+	int64_t bullets_before = 0;
+	int worker_index = 0;
+
+	update->worker_volley_begin[0] = 0;
+
+	for (int volley_index = 0; volley_index < update->volley_count; ++volley_index) {
+		while (worker_index + 1 < update->worker_count &&
+			bullets_before >= total_bullets*(worker_index + 1)/update->worker_count)
+		{
+			update->worker_volley_begin[++worker_index] = volley_index;
+		}
+		if (bullet_volley_asleep(bullets, volley_index, tick, player_travel)) continue;
+		bullets_before += bullets->alive_count[volley_index];
+	}
+
+	while (worker_index < update->worker_count) {
+		update->worker_volley_begin[++worker_index] = update->volley_count;
+	}
+}
+
+static void bullet_grid_reserve(Bullet_Grid *grid, int bullet_count) {
+	if (bullet_count <= grid->bullet_capacity) return;
+
+	int capacity = MAXIMUM(bullet_count, 2*grid->bullet_capacity);
+
+	REALLOC_ARRAY(grid->cell, capacity);
+	REALLOC_ARRAY(grid->volley_index, capacity);
+	REALLOC_ARRAY(grid->lane, capacity);
+	REALLOC_ARRAY(grid->position, capacity);
+	REALLOC_ARRAY(grid->sorted, capacity);
+	REALLOC_ARRAY(grid->owner, capacity);
+	REALLOC_ARRAY(grid->owner_run_end, capacity);
+	REALLOC_ARRAY(grid->sorted_position, capacity);
+	REALLOC_ARRAY(grid->annihilated, capacity);
+
+	grid->bullet_capacity = capacity;
+}
+
+static int bullet_grid_cell_coordinate(Bullet_Grid *grid, float position, int cell_count) {
+	int cell = (int)((position + PLAYZONE_MARGIN)*grid->inv_cell_size);
+	if (cell < 0) cell = 0;
+	if (cell > cell_count - 1) cell = cell_count - 1;
+	return cell;
+}
+
+// NOTE(jakob): Sorts the live bullets of the first volley_count volleys by
+// their cell as of the start of tick
+static void bullet_grid_build(Bullet_Grid *grid, Sim_State *sim, int volley_count, uint32_t tick) {
+	Game_Parameters *game_params = &sim->params;
+	Bullet_Pool *bullets = &sim->bullets;
+	Sim_Arena arena = sim->arena;
+
+	float zone_width = arena.width + 2.0f*PLAYZONE_MARGIN;
+	float zone_height = arena.height + 2.0f*PLAYZONE_MARGIN;
+	float contact = 2.0f*game_params->bullet_radius;
+
+	grid->cell_size = MAXIMUM(contact, MAXIMUM(zone_width, zone_height)/(float)BULLET_GRID_MAX_DIMENSION);
+	grid->inv_cell_size = 1.0f/grid->cell_size;
+	grid->columns = MINIMUM((int)(zone_width*grid->inv_cell_size) + 1, BULLET_GRID_MAX_DIMENSION);
+	grid->rows = MINIMUM((int)(zone_height*grid->inv_cell_size) + 1, BULLET_GRID_MAX_DIMENSION);
+
+	int cell_count = grid->columns*grid->rows;
+	int *cell_start = grid->cell_start;
+	memset(cell_start, 0, (cell_count + 1)*sizeof(*cell_start));
+
+	bullet_grid_reserve(grid, bullets->active_bullets);
+
+	float block_x[64], block_y[64], block_vx[64], block_vy[64];
+	Bullet_Arc_States block = {block_x, block_y, block_vx, block_vy};
+	Bullet_Arc_Kernel arc_kernel = bullet_arc_kernel();
+
+	int bullet_count = 0;
+
+	for (int volley_index = 0; volley_index < volley_count; ++volley_index) {
+		Bullet_Volley *volley = &bullets->volleys[volley_index];
+		const uint64_t *alive_words = bullet_pool_alive_words(bullets, volley_index);
+
+		for (int first_lane = 0; first_lane < volley->count; first_lane += 64) {
+			uint64_t alive = alive_words[first_lane/64];
+			if (!alive) continue;
+
+			int lane_count = MINIMUM(64, volley->count - first_lane);
+			arc_kernel(volley, first_lane, lane_count, tick, block);
+
+			for (uint64_t lanes = alive; lanes; lanes &= lanes - 1) {
+				int block_index = bits_lowest(lanes);
+
+				Vector2 position = {block_x[block_index], block_y[block_index]};
+				int x = bullet_grid_cell_coordinate(grid, position.x, grid->columns);
+				int y = bullet_grid_cell_coordinate(grid, position.y, grid->rows);
+				int cell = y*grid->columns + x;
+
+				grid->cell[bullet_count] = cell;
+				grid->volley_index[bullet_count] = volley_index;
+				grid->lane[bullet_count] = first_lane + block_index;
+				grid->position[bullet_count] = position;
+				++cell_start[cell + 1];
+				++bullet_count;
+			}
+		}
+	}
+
+	assert(bullet_count <= grid->bullet_capacity);
+	grid->bullet_count = bullet_count;
+
+	for (int cell = 0; cell < cell_count; ++cell) {
+		cell_start[cell + 1] += cell_start[cell];
+	}
+
+	for (int bullet_index = 0; bullet_index < bullet_count; ++bullet_index) {
+		int sorted_index = cell_start[grid->cell[bullet_index]]++;
+		grid->sorted[sorted_index] = bullet_index;
+		grid->owner[sorted_index] = bullets->volleys[grid->volley_index[bullet_index]].owner;
+		grid->sorted_position[sorted_index] = grid->position[bullet_index];
+	}
+
+	// The fill advanced every start to the next cell's start; shift back
+	for (int cell = cell_count; cell > 0; --cell) {
+		cell_start[cell] = cell_start[cell - 1];
+	}
+	cell_start[0] = 0;
+
+	// NOTE(jakob): A volley's bullets are adjacent within a cell, so a
+	// player's fresh volleys make long runs right where they spawn
+	for (int cell = 0; cell < cell_count; ++cell) {
+		int run_end = cell_start[cell + 1];
+		for (int sorted_index = cell_start[cell + 1] - 1; sorted_index >= cell_start[cell]; --sorted_index) {
+			if (sorted_index + 1 < cell_start[cell + 1] && grid->owner[sorted_index + 1] != grid->owner[sorted_index]) {
+				run_end = sorted_index + 1;
+			}
+			grid->owner_run_end[sorted_index] = run_end;
+		}
+	}
+
+	memset(grid->annihilated, 0, (size_t)bullet_count*sizeof(*grid->annihilated));
+}
+
+// NOTE(jakob): The first bullet in sorted_begin to sorted_end that is still
+// there, is not the owner's and touches the bullet at sorted_index, or -1
+static int bullet_grid_find_partner(Bullet_Grid *grid, int sorted_index, int sorted_begin, int sorted_end, float contact_squared, int *tests) {
+	int owner = grid->owner[sorted_index];
+	Vector2 position = grid->sorted_position[sorted_index];
+
+	for (int other_index = sorted_begin; other_index < sorted_end; ++other_index) {
+		if (grid->owner[other_index] == owner) {
+			other_index = grid->owner_run_end[other_index] - 1;
+			continue;
+		}
+
+		if (grid->annihilated[other_index]) continue;
+
+		++*tests;
+
+		if (Vector2LengthSqr(Vector2Subtract(grid->sorted_position[other_index], position)) < contact_squared) {
+			return other_index;
+		}
+	}
+
+	return -1;
+}
+
+// NOTE(jakob): Bullets of different players that touch at the end of the
+// tick cancel each other out, one for one. The cells are visited in order
+// and each bullet takes the first partner it finds after it in its own cell,
+// then in the cells to the east, south-west, south and south-east, so every
+// neighbouring pair is looked at once and the pairing does not depend on
+// the worker count.
+static void bullet_annihilation_update(Sim_State *sim, int volley_count, uint32_t tick) {
+	Bullet_Grid *grid = &sim->bullet_grid;
+	Bullet_Pool *bullets = &sim->bullets;
+	Collision_Stats *stats = &sim->collision_stats;
+
+	bullet_grid_build(grid, sim, volley_count, tick);
+
+	float contact = 2.0f*sim->params.bullet_radius;
+	float contact_squared = contact*contact;
+
+	static const int neighbour_offsets[][2] = {{1, 0}, {-1, 1}, {0, 1}, {1, 1}};
+
+	for (int y = 0; y < grid->rows; ++y) {
+		for (int x = 0; x < grid->columns; ++x) {
+			int cell = y*grid->columns + x;
+			int cell_begin = grid->cell_start[cell];
+			int cell_end = grid->cell_start[cell + 1];
+			if (cell_begin == cell_end) continue;
+
+			// NOTE(jakob): A cell of one player's bullets has nothing to pair
+			// with in itself or in neighbours that only hold that player's
+			// bullets, which is most cells around a player who keeps firing
+			bool mixed = grid->owner_run_end[cell_begin] != cell_end;
+			int cell_owner = grid->owner[cell_begin];
+
+			int neighbour_count = 0;
+			int neighbour_begin[4], neighbour_end[4];
+
+			for (int neighbour = 0; neighbour < 4; ++neighbour) {
+				int neighbour_x = x + neighbour_offsets[neighbour][0];
+				int neighbour_y = y + neighbour_offsets[neighbour][1];
+				if (neighbour_x < 0 || neighbour_x >= grid->columns || neighbour_y >= grid->rows) continue;
+
+				int neighbour_cell = neighbour_y*grid->columns + neighbour_x;
+				int begin = grid->cell_start[neighbour_cell];
+				int end = grid->cell_start[neighbour_cell + 1];
+				if (begin == end) continue;
+				if (!mixed && grid->owner_run_end[begin] == end && grid->owner[begin] == cell_owner) continue;
+
+				neighbour_begin[neighbour_count] = begin;
+				neighbour_end[neighbour_count] = end;
+				++neighbour_count;
+			}
+
+			if (!mixed && neighbour_count == 0) continue;
+
+			for (int sorted_index = cell_begin; sorted_index < cell_end; ++sorted_index) {
+				if (grid->annihilated[sorted_index]) continue;
+
+				int partner = -1;
+				if (mixed) {
+					partner = bullet_grid_find_partner(grid, sorted_index, sorted_index + 1, cell_end, contact_squared, &stats->bullet_annihilation_tests);
+				}
+
+				for (int neighbour = 0; neighbour < neighbour_count && partner < 0; ++neighbour) {
+					partner = bullet_grid_find_partner(grid, sorted_index, neighbour_begin[neighbour], neighbour_end[neighbour], contact_squared, &stats->bullet_annihilation_tests);
+				}
+
+				if (partner < 0) continue;
+
+				grid->annihilated[sorted_index] = true;
+				grid->annihilated[partner] = true;
+				stats->bullets_annihilated += 2;
+
+				int bullet_index = grid->sorted[sorted_index];
+				int partner_index = grid->sorted[partner];
+				bullet_pool_kill_lane(bullets, grid->volley_index[bullet_index], grid->lane[bullet_index]);
+				bullet_pool_kill_lane(bullets, grid->volley_index[partner_index], grid->lane[partner_index]);
+
+				Vector2 position = grid->sorted_position[sorted_index];
+				Vector2 partner_position = grid->sorted_position[partner];
+				Vector2 diff = Vector2Subtract(partner_position, position);
+
+				sim_event_push(sim, (Sim_Event){
+					.type = SIM_EVENT_ANNIHILATION,
+					.player_index = grid->owner[sorted_index],
+					.other_player_index = grid->owner[partner],
+					.angle = sim_atan2f(diff.x, diff.y)*(180.0f/PI),
+					.position = Vector2Add(position, Vector2Scale(diff, 0.5f)),
+				});
+			}
+		}
+	}
+}
+
+// NOTE(jakob): Each bot chases one opponent, charging and releasing shots at
+// random intervals. A bot keeps its target until the target dies and then
+// takes the next living player after it, so finding targets is linear in the
+// player count over a whole match. Bots run on the fixed tick with their own
+// random state, so they play the same way at any frame rate.
+static void player_bots_update(Sim_State *sim, float dt) {
+	Game_Parameters *game_params = &sim->params;
+	int num_players = game_params->num_players;
+
+	Entity_Query living_bots = entity_query(&sim->entities, ENTITY_MASK(ENTITY_ALIVE) | ENTITY_MASK(ENTITY_BOT), 0);
+	for (int player_index; (player_index = entity_query_next(&living_bots)) >= 0;) {
+
+		Player *player = sim->players + player_index;
+		Player_Bot *bot = sim->player_bots + player_index;
+		Virtual_Input_Device_State *state = &bot->input;
+
+		*state = (Virtual_Input_Device_State){0};
+
+		if (bot->target_index == player_index || !entity_has(&sim->entities, bot->target_index, ENTITY_ALIVE)) {
+			int target_index = bot->target_index;
+			do {
+				target_index = (target_index + 1) % num_players;
+			} while (target_index != player_index && !entity_has(&sim->entities, target_index, ENTITY_ALIVE));
+			bot->target_index = target_index;
+		}
+
+		if (bot->target_index != player_index) {
+			Vector2 to_target = Vector2Subtract(sim->players[bot->target_index].position, player->position);
+			state->direction = Vector2NormalizeOrZero(to_target);
+		}
+
+		Virtual_Input_Button *action = &state->buttons[VIRTUAL_BUTTON_ACTION];
+
+		if (bot->charge_time > 0.0f) {
+			bot->charge_time -= dt;
+			if (bot->charge_time > 0.0f) {
+				action->is_down = true;
+			}
+			else {
+				action->is_released = true;
+				bot->rest_time = 0.5f + 2.0f*random_01(&bot->random_state);
+			}
+		}
+		else {
+			bot->rest_time -= dt;
+			if (bot->rest_time <= 0.0f) {
+				bot->charge_time = 0.1f + 0.6f*random_01(&bot->random_state);
+				action->is_down = true;
+			}
+		}
+	}
+}
+
+void sim_update_fixed(Sim_State *sim) {
+
+	const float dt = TIME_STEP_FIXED;
+	Game_Parameters *game_params = &sim->params;
+
+	sim->sim_time += dt;
+
+	sim_events_begin_tick(&sim->events, sim->tick_count);
+
+	// NOTE(jakob): A bullet takes lifetime_ticks steps, starting in its first
+	// step tick, and expires at the start of the bullet window after its last
+	// step. Bullets are stepped once per window, on its last tick.
+	uint32_t tick = sim->tick_count;
+	uint32_t lifetime_ticks = (uint32_t)(game_params->bullet_time_end_fade/dt + 0.5f);
+	int divisor = game_params->bullet_tick_divisor;
+	uint32_t window_begin = tick - tick%(uint32_t)divisor;
+	bool bullet_tick = tick + 1 - window_begin == (uint32_t)divisor;
+
+	if (tick == window_begin) {
+		bullet_pool_expire(&sim->bullets, tick, lifetime_ticks);
+	}
+	sim->bullets.first_step_tick = tick;
+
+	player_bots_update(sim, dt);
+
+	// NOTE(jakob): Where each player starts each tick of the bullet window, for
+	// sweeping the bullets against every tick of the players' motion
+	{
+		int path_point = (int)(tick - window_begin);
+		Entity_Query living = entity_query(&sim->entities, ENTITY_MASK(ENTITY_ALIVE), 0);
+		for (int player_index; (player_index = entity_query_next(&living)) >= 0;) {
+			player_grid_path(&sim->player_grid, player_index)[path_point] = sim->players[player_index].position;
+		}
+	}
+
+	// Update player motion
+	Entity_Query living = entity_query(&sim->entities, ENTITY_MASK(ENTITY_ALIVE), 0);
+	for (int player_index; (player_index = entity_query_next(&living)) >= 0;) {
+
+		Player *player = &sim->players[player_index];
+
+		Virtual_Input_Device_State input = entity_has(&sim->entities, player_index, ENTITY_LOCAL) ?
+			sim->local_inputs[player_index] :
+			sim->player_bots[player_index].input;
+		Vector2 control = input.direction;
+
+		float friction_fraction = 1.0f;
+
+		if (control.x == 0.0f && control.y == 0.0f) {
+			friction_fraction = 0.1f;
+		}
+		else {
+
+			float control_angle = sim_atan2f(control.y, control.x);
+
+			// Normalize player movement controls
+			control = Vector2NormalizeOrZero(control);
+
+			float old_angle = player->shoot_angle;
+			player->shoot_angle = lerp_angle(player->shoot_angle, control_angle, 3.0f * dt);
+
+			float angular_pulse = 10.0f*shortest_angle_difference(old_angle, player->shoot_angle);
+
+			player->angular_velocity = 0.5f*player->angular_velocity + 0.5f*angular_pulse;
+
+		}
+
+		Vector2 acceleration = Vector2Scale(control, game_params->acceleration_force * dt);
+
+		acceleration = Vector2Subtract(acceleration, Vector2Scale(player->velocity, game_params->friction * friction_fraction * dt));
+
+		//
+		// Shooting:
+		//
+		if (player->shoot_time_out < sim->sim_time) {
+
+			if (input.buttons[VIRTUAL_BUTTON_ACTION].is_down && player->shoot_charge_t < 1.0f) {
+				float full_charges_per_second = game_params->full_charges_per_second;
+
+				player->shoot_charge_t += full_charges_per_second * dt;
+				if (player->shoot_charge_t > 1.0f) {
+					player->shoot_charge_t = 1.0f;
+				}
+			}
+			else if (input.buttons[VIRTUAL_BUTTON_ACTION].is_released) {
+				float shoot_cooldown_seconds = 1.0f;
+				player->shoot_time_out = sim->sim_time + shoot_cooldown_seconds;
+
+				float comeback_factor = sim->player_comeback_factor[player_index];
+				float speed = 50.0f + (400.0f + comeback_factor*650.0f)*player->shoot_charge_t;
+
+				Vector2 shoot_vector = (Vector2){sim_cosf(player->shoot_angle), sim_sinf(player->shoot_angle)};
+
+				float recoil_factor = Vector2DotProduct(shoot_vector, Vector2NormalizeOrZero(player->velocity));
+
+				if (recoil_factor < 0) {
+					recoil_factor = 0;
+				}
+
+				float angle_span;
+				int bullet_count;
+				calculate_bullet_count_and_angle_span(player, game_params, &bullet_count, &angle_span);
+
+				spawn_bullet_fan(player, sim, bullet_count, speed, angle_span);
+
+				acceleration = Vector2Subtract(acceleration, Vector2Scale(shoot_vector, speed*recoil_factor));
+
+				player->shoot_charge_t = 0.0f;
+			}
+		}
+
+		player->velocity = Vector2Add(player->velocity, acceleration);
+	}
+
+	// Player collision detection and response
+	//
+	Player_Sweep *sweep = &sim->player_sweep;
+
+	// NOTE(jakob): The radii as of after shooting. From here on, the contact
+	// rings and the motion loop refresh a player's radius when they change
+	// its energy, so the rest of the tick and the bullet pass read these.
+	living = entity_query(&sim->entities, ENTITY_MASK(ENTITY_ALIVE), 0);
+	for (int player_index; (player_index = entity_query_next(&living)) >= 0;) {
+		sweep->radius[player_index] = calculate_player_radius(sim->players + player_index, game_params);
+	}
+
+	player_pairs_update(sweep, sim, dt);
+	player_contacts_update(&sim->player_contacts, sweep, game_params->num_players);
+	player_contacts_solve(sim, dt);
+
+	living = entity_query(&sim->entities, ENTITY_MASK(ENTITY_ALIVE), 0);
+	for (int player_index; (player_index = entity_query_next(&living)) >= 0;) {
+
+		Player *player = sim->players + player_index;
+
+		float player_radius = sweep->radius[player_index];
+
+		Vector2 from_position = player->position;
+		Vector2 target_position = Vector2Add(
+			player->position,
+			Vector2Scale(player->velocity, dt)
+		);
+
+		// Bounce on view edges
+		{
+			float bounce_back_factor = -0.6f;
+			float edge_offset;
+
+			float cumulative_edge_bounce = 0.0f;
+
+			Sim_Arena arena = sim->arena;
+
+			if (player->velocity.x > 0) {
+				edge_offset = arena.width - (target_position.x + player_radius);
+
+				if (edge_offset < 0) {
+					float contact = arena.width - player_radius;
+					float remaining_t = 1.0f - edge_time_of_impact(from_position.x, target_position.x, contact);
+
+					cumulative_edge_bounce += fabs(player->velocity.x);
+
+					player->velocity.x = bounce_back_factor*(player->velocity.x + edge_offset);
+					target_position.x = contact + remaining_t*player->velocity.x*dt;
+				}
+			}
+			else {
+				edge_offset = (target_position.x - player_radius) - 0;
+
+				if (edge_offset < 0) {
+					float contact = 0 + player_radius;
+					float remaining_t = 1.0f - edge_time_of_impact(from_position.x, target_position.x, contact);
+
+					cumulative_edge_bounce += fabs(player->velocity.x);
+
+					player->velocity.x = bounce_back_factor*(player->velocity.x + edge_offset);
+					target_position.x = contact + remaining_t*player->velocity.x*dt;
+				}
+			}
+
+			if (player->velocity.y > 0) {
+
+				edge_offset = arena.height - (target_position.y + player_radius);
+
+				if (edge_offset < 0) {
+					float contact = arena.height - player_radius;
+					float remaining_t = 1.0f - edge_time_of_impact(from_position.y, target_position.y, contact);
+
+					cumulative_edge_bounce += fabs(player->velocity.y);
+
+					player->velocity.y = bounce_back_factor*(player->velocity.y + edge_offset);
+					target_position.y = contact + remaining_t*player->velocity.y*dt;
+				}
+			}
+			else {
+				edge_offset = (target_position.y - player_radius) - 0;
+
+				if (edge_offset < 0) {
+					float contact = 0 + player_radius;
+					float remaining_t = 1.0f - edge_time_of_impact(from_position.y, target_position.y, contact);
+
+					cumulative_edge_bounce += fabs(player->velocity.y);
+
+					player->velocity.y = bounce_back_factor*(player->velocity.y + edge_offset);
+					target_position.y = contact + remaining_t*player->velocity.y*dt;
+				}
+			}
+
+			// NOTE(jakob): One sample of the obstacle field gives the overlap
+			// and the normal; the player is pushed out along it and its
+			// velocity into the obstacle bounces back like off an edge
+			const Obstacle_Field *obstacles = sim_obstacles(sim);
+
+			if (obstacles) {
+				Vector2 normal;
+				float obstacle_distance = obstacle_field_distance(obstacles, target_position, &normal);
+
+				if (obstacle_distance < player_radius) {
+					float normal_speed = Vector2DotProduct(player->velocity, normal);
+
+					if (normal_speed < 0.0f) {
+						cumulative_edge_bounce += fabs(normal_speed);
+						player->velocity = Vector2Subtract(player->velocity, Vector2Scale(normal, (1.0f - bounce_back_factor)*normal_speed));
+					}
+
+					target_position = Vector2Add(target_position, Vector2Scale(normal, player_radius - obstacle_distance));
+				}
+			}
+
+			if (hit_is_hard_enough(cumulative_edge_bounce)) {
+				spawn_bullet_ring(player, sim);
+			}
+		}
+
+		player->position = target_position;
+
+		float speed = Vector2Length(player->velocity);
+
+		float comeback_energy = sim->player_comeback_factor[player_index];
+		player->energy += dt * (speed * (1 + comeback_energy)) / (player->energy*2.0f + 1.0f);
+		sweep->radius[player_index] = calculate_player_radius(player, game_params);
+	}
+
+	Collision_Stats *stats = &sim->collision_stats;
+	stats->bullet_checks = 0;
+	stats->bullet_checks_skipped = 0;
+	stats->bullet_pair_tests = 0;
+	stats->bullet_pair_tests_skipped = 0;
+	stats->bullet_annihilation_tests = 0;
+	stats->bullets_annihilated = 0;
+	stats->bullets_stopped_by_obstacles = 0;
+
+	if (!bullet_tick) {
+		sim->tick_count = tick + 1;
+		return;
+	}
+
+	// Update bullets
+	Bullet_Pool *bullets = &sim->bullets;
+
+	player_grid_build(&sim->player_grid, sim);
+
+	Bullet_Update *update = &sim->bullet_update;
+	update->sim = sim;
+	update->volley_count = bullets->active_volleys;
+	update->window_begin = window_begin;
+	update->lifetime_ticks = lifetime_ticks;
+	bullet_update_split(update, bullets, sim->workers.worker_count, tick, sim->player_grid.player_travel);
+
+	worker_pool_run(&sim->workers, bullet_update_worker, update, update->worker_count);
+
+	bullets->first_step_tick = tick + 1;
+
+	int deaths = 0;
+
+	// Apply the hits in bullet order
+	for (int worker_index = 0; worker_index < update->worker_count; ++worker_index) {
+		Bullet_Worker *worker = &update->workers[worker_index];
+
+		stats->bullet_checks += worker->stats.bullet_checks;
+		stats->bullet_checks_skipped += worker->stats.bullet_checks_skipped;
+		stats->bullet_pair_tests += worker->stats.bullet_pair_tests;
+		stats->bullet_pair_tests_skipped += worker->stats.bullet_pair_tests_skipped;
+		stats->bullets_stopped_by_obstacles += worker->stats.bullets_stopped_by_obstacles;
+
+		for (int hit_index = 0; hit_index < worker->hit_count; ++hit_index) {
+			Bullet_Hit *hit = &worker->hits[hit_index];
+
+			Player *opponent = sim->players + hit->opponent_index;
+
+			// NOTE(jakob): An earlier hit this tick may already have killed the opponent
+			if (opponent->health <= 0) continue;
+
+			bullet_pool_kill_lane(bullets, hit->volley_index, hit->lane);
+
+			int player_index = bullets->volleys[hit->volley_index].owner;
+			Vector2 bullet_position = hit->bullet_position;
+
+			--opponent->health;
+			sim->player_comeback_factor[hit->opponent_index] = calculate_player_comeback_factor(opponent, game_params);
+
+			Vector2 diff = Vector2Subtract(bullet_position, hit->opponent_position);
+
+			diff = Vector2NormalizeOrZero(diff);
+
+			float bullet_mass = 0.125f;
+			float bullet_speed = hit->bullet_speed;
+
+			opponent->velocity = Vector2Subtract(opponent->velocity, Vector2Scale(diff, bullet_mass*bullet_speed));
+
+			float ring_angle = sim_atan2f(diff.x, diff.y)*(180.0f/PI);
+
+			sim_event_push(sim, (Sim_Event){
+				.type = SIM_EVENT_HIT,
+				.player_index = hit->opponent_index,
+				.other_player_index = player_index,
+				.position = bullet_position,
+			});
+
+			sim_event_push(sim, (Sim_Event){
+				.type = SIM_EVENT_RING,
+				.player_index = player_index,
+				.other_player_index = hit->opponent_index,
+				.angle = ring_angle,
+				.position = bullet_position,
+			});
+
+			if (opponent->health <= 0) {
+
+				++deaths;
+
+				float bullet_speed = 8 + (2*(opponent->energy/game_params->bullet_energy_cost_ring));
+
+				spawn_bullet_ring_ex(
+					opponent,
+					sim,
+					bullet_speed,
+					200.0f + 10.0f*opponent->energy,
+					bullet_speed * 0.025f
+				);
+
+				sim_event_push(sim, (Sim_Event){
+					.type = SIM_EVENT_DEATH,
+					.player_index = hit->opponent_index,
+					.other_player_index = player_index,
+					.position = opponent->position,
+				});
+
+				// Game ends
+
+				if (sim->triumphant_player == -1) {
+					++sim->num_dead_players;
+
+					if (sim_is_game_over(sim)) {
+
+						int triumphant_player = 0;
+
+						while (triumphant_player < game_params->num_players) {
+							if (sim->players[triumphant_player].health > 0) break;
+							++triumphant_player;
+						}
+
+						sim->triumphant_player = triumphant_player;
+
+						sim_event_push(sim, (Sim_Event){
+							.type = SIM_EVENT_WIN,
+							.player_index = triumphant_player,
+							.other_player_index = -1,
+							.position = sim->players[triumphant_player].position,
+						});
+					}
+				}
+
+			}
+		}
+	}
+
+	if (deaths > 0) {
+		sim_drop_dead_players(sim);
+	}
+
+	// NOTE(jakob): Volleys spawned by deaths above were appended after the
+	// updated ones; they start moving next tick, so they cannot cancel out yet.
+	if (game_params->bullet_annihilation) {
+		bullet_annihilation_update(sim, update->volley_count, tick + 1);
+	}
+
+	bullet_pool_compact(bullets);
+
+	sim->tick_count = tick + 1;
+}
+
+// NOTE(jakob): For when the play area changes during a match, e.g. because
+// the window was resized. Players left outside it are put back at the edge.
+void sim_set_arena(Sim_State *sim, Sim_Arena arena) {
+	Game_Parameters *game_params = &sim->params;
+
+	sim->arena = arena;
+
+	// NOTE(jakob): The playzone moves and players may be moved into the arena
+	// outside the fixed tick, so every volley is tested again
+	for (int volley_index = 0; volley_index < sim->bullets.active_volleys; ++volley_index) {
+		sim->bullets.wake_key[volley_index] = -INFINITY;
+	}
+
+	Entity_Query living = entity_query(&sim->entities, ENTITY_MASK(ENTITY_ALIVE), 0);
+	for (int player_index; (player_index = entity_query_next(&living)) >= 0;) {
+
+		Player *player = sim->players + player_index;
+
+		float radius = calculate_player_radius(player, game_params);
+
+		bool inside = (
+			player->position.x >= 0 && player->position.x < arena.width &&
+			player->position.y >= 0 && player->position.y < arena.height
+		);
+
+		if (!inside) {
+
+			Vector2 min_corner = Vector2SubtractValue(player->position, radius);
+			Vector2 max_corner = Vector2AddValue(player->position, radius);
+
+			if (min_corner.x < 0) {
+				player->position.x = radius;
+			}
+			else if (max_corner.x > arena.width) {
+				player->position.x = arena.width - radius;
+			}
+
+			if (min_corner.y < 0) {
+				player->position.y = radius;
+			}
+			else if (max_corner.y > arena.height) {
+				player->position.y = arena.height - radius;
+			}
+
+		}
+	}
+}
+
+const Game_Parameters sim_default_params = {
+	.num_players = 4,
+	.num_local_players = 4,
+
+	.starting_health = 2,
+	.minimum_radius = 32.0f,
+	.acceleration_force = 1100.0f,
+	.friction = 0.94f,
+
+	.bullet_energy_cost_ring = 2.5f,
+	.bullet_energy_cost_fan = 4.0f,
+	.bullet_radius = 15.0f,
+	.bullet_time_end_fade = 7.0f,
+	.bullet_time_begin_fade = (7.0f-0.4f),
+
+	.slowdowns_per_second = 1.0f,
+	.full_charges_per_second = 1.5f,
+
+	.comeback_base_factor = 1.0f, // NOTE(jakob & patrick): energy_gained = xxxx + comeback_base_factor*(1.0f - ((float)health/(float)starting_health))
+	.slow_motion_slowest_factor = 0.3f,
+
+	.bullet_memory_budget = 8*1024*1024,
+	.bullet_tick_divisor = 1,
+
+	.bullet_annihilation = false,
+	.obstacles = false,
+};
+
+const bool sim_deterministic = JJ_DETERMINISTIC;
+
+void sim_init(Sim_State *sim, int worker_count) {
+	bullet_kernels_init();
+
+	if (worker_count <= 0) {
+		// NOTE(jakob): JJ_SIM_THREADS overrides the worker count, e.g. for
+		// checking that results do not depend on it
+		const char *threads_override = getenv("JJ_SIM_THREADS");
+		worker_count = threads_override ? atoi(threads_override) : MINIMUM(cpu_count(), 8);
+	}
+	worker_pool_init(&sim->workers, worker_count);
+
+	const char *generic_override = getenv("JJ_SIM_GENERIC");
+	sim->generic_lobby = generic_override && atoi(generic_override) != 0;
+
+#ifndef NDEBUG
+	{
+		bool kernels_match = bullet_kernels_self_check(TIME_STEP_FIXED, NULL);
+		assert(kernels_match);
+		UNUSED(kernels_match);
+
+		bool fixed_trig_matches = fixed_trig_self_check(NULL);
+		assert(fixed_trig_matches);
+		UNUSED(fixed_trig_matches);
+	}
+#endif
+}
+
+const char *sim_lobby_variant_name(const Sim_State *sim) {
+	switch (sim->lobby_players) {
+		case 2: return "2 players";
+		case 3: return "3 players";
+		case 4: return "4 players";
+		default: return "generic";
+	}
+}
+
+static void player_grid_release(Player_Grid *grid) {
+	free(grid->player_radius);
+	free(grid->player_path);
+	free(grid->player_path_min);
+	free(grid->player_path_max);
+	free(grid->active_tiles);
+	free(grid->cell_start);
+	free(grid->entries);
+	*grid = (Player_Grid){0};
+}
+
+static void player_sweep_release(Player_Sweep *sweep) {
+	free(sweep->order);
+	free(sweep->min_x);
+	free(sweep->max_x);
+	free(sweep->y);
+	free(sweep->radius);
+	free(sweep->pair_sort_counts);
+	free(sweep->pairs);
+	free(sweep->pairs_scratch);
+	*sweep = (Player_Sweep){0};
+}
+
+static void player_contacts_release(Player_Contacts *contacts) {
+	free(contacts->contacts);
+	free(contacts->previous);
+	free(contacts->moved_stamp);
+	free(contacts->island_parent);
+	free(contacts->island_start);
+	free(contacts->island_contacts);
+	free(contacts->island_roots);
+	free(contacts->island_settled);
+	free(contacts->player_colors);
+	free(contacts->color_contacts);
+	*contacts = (Player_Contacts){0};
+}
+
+static void bullet_grid_release(Bullet_Grid *grid) {
+	free(grid->cell);
+	free(grid->volley_index);
+	free(grid->lane);
+	free(grid->position);
+	free(grid->sorted);
+	free(grid->owner);
+	free(grid->owner_run_end);
+	free(grid->sorted_position);
+	free(grid->annihilated);
+	*grid = (Bullet_Grid){0};
+}
+
+static void bullet_update_release(Bullet_Update *update) {
+	for (int worker_index = 0; worker_index < MAX_WORKERS; ++worker_index) {
+		Bullet_Worker *worker = &update->workers[worker_index];
+		free(worker->hits);
+		free(worker->query.stamps);
+		free(worker->query.candidates);
+	}
+	*update = (Bullet_Update){0};
+}
+
+// NOTE(jakob): Frees everything the sim owns, so a server can run match after
+// match in one process
+void sim_shutdown(Sim_State *sim) {
+	worker_pool_shutdown(&sim->workers);
+	bullet_pool_release(&sim->bullets);
+	obstacle_field_release(&sim->obstacles);
+
+	player_grid_release(&sim->player_grid);
+	player_sweep_release(&sim->player_sweep);
+	player_contacts_release(&sim->player_contacts);
+	bullet_grid_release(&sim->bullet_grid);
+	bullet_update_release(&sim->bullet_update);
+
+	free(sim->events.events);
+	sim->events.events = NULL;
+	sim->events.count = 0;
+	sim->events.capacity = 0;
+
+	free(sim->players);
+	free(sim->player_bots);
+	free(sim->player_comeback_factor);
+	sim->players = NULL;
+	sim->player_bots = NULL;
+	sim->player_comeback_factor = NULL;
+	sim->player_capacity = 0;
+	sim->entities = (Entity_Set){0};
+}
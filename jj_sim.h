@@ -0,0 +1,596 @@
+#ifndef JJ_SIM_H
+#define JJ_SIM_H
+
+// NOTE(jakob): The simulation of a match: players, bots, bullets and their
+// collisions, advanced one fixed tick at a time. It only needs libc, libm and
+// pthreads, so it builds on its own as libjj_sim for dedicated servers, batch
+// runs and benchmarks on machines without a display (see jj_headless.c).
+// main.c is the raylib front-end that feeds it local input and draws it.
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <math.h>
+
+// NOTE(jakob): Same layout as raylib's Vector2, which the front-end gets by
+// including raylib.h before this header
+#ifndef RAYLIB_H
+typedef struct Vector2 {
+	float x;
+	float y;
+} Vector2;
+
+#ifndef PI
+#define PI 3.14159265358979323846f
+#endif
+#endif
+
+#include "jj_fixed.h"
+#include "jj_bullets.h"
+#include "jj_entities.h"
+#include "jj_math.h"
+#include "jj_obstacles.h"
+#include "jj_threads.h"
+
+#define MINIMUM(a, b) ((a) < (b) ? (a) : (b))
+#define MAXIMUM(a, b) ((a) > (b) ? (a) : (b))
+
+#define UNUSED(var) ((void)(var))
+
+#define REALLOC_ARRAY(array, count) do { \
+	(array) = realloc((array), (size_t)(count)*sizeof(*(array))); \
+	assert(array); \
+} while (0)
+
+// NOTE(jakob): Bullet hits and edge bounces use swept tests, so the fixed
+// step can be made coarser (e.g. -DTIME_STEP_FIXED=0.025f) on slow machines.
+#ifndef TIME_STEP_FIXED
+#define TIME_STEP_FIXED 0.01f
+#endif
+
+typedef struct Virtual_Input_Button {
+	bool is_down;
+	bool is_pressed;
+	bool is_released;
+	// TODO(jakob): Make possible to detect multiple keystrokes per frame (state_transition_count) 
+	// int state_transition_count;
+} Virtual_Input_Button;
+
+enum {
+	VIRTUAL_BUTTON_ACTION = 0,
+	VIRTUAL_BUTTON_MENU = 1,
+
+	VIRTUAL_BUTTON_COUNT
+};
+
+typedef struct Virtual_Input_Device_State {
+	Vector2 direction; // NOTE(jakob): Valid in unit circle
+	Virtual_Input_Button buttons[VIRTUAL_BUTTON_COUNT];
+} Virtual_Input_Device_State;
+
+// NOTE(jakob): Only the simulation state of a player; the front-end keeps its
+// animation and text state apart. The fields the collision and bullet passes
+// read come first, so they are the first 24 of the 40 bytes.
+typedef struct Player {
+	Vector2 position;
+	Vector2 velocity;
+	float energy;
+	int health;
+	float angular_velocity;
+	float shoot_angle;
+	float shoot_time_out;
+	float shoot_charge_t;
+} Player;
+
+// NOTE(jakob): The first num_local_players players are controlled through
+// local_inputs, which the front-end fills from the keyboard and gamepads; the
+// rest of a lobby are bots.
+#define MAX_LOCAL_PLAYERS 4
+#define MAX_LOBBY_PLAYERS MAX_ENTITIES
+#define MAX_SMALL_LOBBY_PLAYERS 4 // Lobbies up to this size get pair and opponent tests written out for their size
+
+// NOTE(jakob): A bot drives its player through its own input state, so the
+// player update treats bots and local players the same way.
+typedef struct Player_Bot {
+	Virtual_Input_Device_State input;
+	uint64_t random_state;
+	int target_index;
+	float charge_time; // Time left holding the action button
+	float rest_time; // Time left until the next charge starts
+} Player_Bot;
+
+// NOTE(jakob): Stays valid while the bullet lives; a stale handle (the
+// bullet's volley was removed and its slot reused) fails the generation check
+// on lookup, and a removed bullet of a live volley fails the alive check.
+typedef struct Bullet_Handle {
+	uint32_t slot;
+	uint32_t generation;
+	int lane;
+} Bullet_Handle;
+
+typedef struct Bullet_Pool_Metrics {
+	int capacity; // Bullets that fit in the alive words
+	int volley_capacity;
+	int peak_active_bullets;
+	int peak_active_volleys;
+	int grow_count;
+	int dropped_bullets; // Spawns refused because of the memory budget
+	size_t bytes_reserved;
+	size_t memory_budget;
+} Bullet_Pool_Metrics;
+
+// NOTE(jakob): All bullets of a match live in one pool of volley records (see
+// jj_bullets.h) in spawn order. A bullet is a lane of its volley plus one
+// alive bit, so a bullet costs a bit and a share of its volley's record
+// instead of a record of its own, and a snapshot of the pool is a couple of
+// small copies. Handles map through slots to the volley index. The pool grows
+// in chunks up to the match's memory budget and is released when a new
+// match starts.
+//
+// Every bullet lives for the same number of ticks and the volleys are sorted
+// by spawn tick, so the expired volleys are always a prefix. Expiry drops
+// that prefix by moving the start of the dense arrays (dense_offset and
+// word_offset) forward, which costs O(expired) instead of a check per bullet
+// per tick.
+typedef struct Bullet_Pool {
+#define BULLET_POOL_CHUNK 256 // Volleys
+#define BULLET_POOL_WORD_CHUNK 1024 // Alive words of 64 bullets
+	int active_bullets;
+	int active_volleys;
+	int active_words;
+	int volley_capacity;
+	int word_capacity;
+	int dense_offset; // Volley arrays start this far into their allocation
+	int word_offset; // alive_words starts this far into its allocation
+	uint32_t first_step_tick; // The first tick that bullets spawned now move in
+
+	void *memory;
+
+	// Dense, indexed by volley index
+	Bullet_Volley *volleys;
+	int *first_word; // Of the volley's alive words, counted from the start of the allocation
+	int *alive_count;
+	uint32_t *slot;
+	double *wake_key; // Asleep while the volley's max step*tick + player_travel is below this
+
+	// Bit lane%64 of word lane/64 of a volley's words is set while the lane lives
+	uint64_t *alive_words;
+
+	// Indexed by slot
+	uint32_t *slot_generation;
+	int *slot_volley_index; // Counted from the start of the allocation
+	uint32_t *free_slots;
+	int free_slot_count;
+
+	Bullet_Pool_Metrics metrics;
+} Bullet_Pool;
+
+typedef struct Game_Parameters {
+	int num_players;
+	int num_local_players;
+	int starting_health;
+	float minimum_radius;
+	float acceleration_force;
+	float friction;
+	float comeback_base_factor; // TODO(jakob) spell comeback -> comeback
+
+	float bullet_energy_cost_ring;
+	float bullet_energy_cost_fan;
+	float bullet_radius;
+	float bullet_time_end_fade;
+	float bullet_time_begin_fade;
+
+	float slowdowns_per_second;
+	float full_charges_per_second;
+
+	float slow_motion_slowest_factor;
+
+	size_t bullet_memory_budget;
+
+	// NOTE(jakob): Players step every fixed tick, bullets once every
+	// bullet_tick_divisor ticks over the whole window, on its last tick.
+	// Bullets stay on their arcs, so only their hits and stops are checked
+	// less often. Each tick of a bullet's motion is swept against where each
+	// opponent moved that tick, but the hits and stops found are applied on
+	// the last tick of the window, up to bullet_tick_divisor - 1 ticks late.
+#define MAX_BULLET_TICK_DIVISOR 4
+	int bullet_tick_divisor;
+
+	bool bullet_annihilation; // Bullets of different players cancel each other out on contact
+	bool obstacles; // Players bounce off and bullets stop at Sim_State.obstacles
+} Game_Parameters;
+
+// NOTE(jakob): The area players bounce inside, in view units. Bullets live
+// until they leave it by more than PLAYZONE_MARGIN.
+typedef struct Sim_Arena {
+	float width;
+	float height;
+} Sim_Arena;
+
+// NOTE(jakob): Uniform grid over the play zone, rebuilt every bullet tick.
+// Each living player is listed in every cell that the box around its path
+// this bullet window (grown by its radius plus the bullet radius) overlaps, so a bullet
+// only has to test the players listed in the cells its own motion overlaps.
+// Cells are at least as large as that reach and the largest box around a
+// player's path, which bounds a player to 4x4 cells.
+//
+// The playzone is split into tiles of PLAYER_GRID_TILE by
+// PLAYER_GRID_TILE cells, and only the tiles touched by a living player's
+// reach this tick get a cell table, so building and querying the grid costs
+// the same in an arena many screens across as in one screen. The cells stay
+// about one reach wide; an arena wider than PLAYER_GRID_MAX_TILE_DIMENSION
+// tiles of those gets wider cells.
+typedef struct Player_Grid {
+#define PLAYER_GRID_TILE 4 // Cells per side of a tile
+#define PLAYER_GRID_TILE_CELLS (PLAYER_GRID_TILE*PLAYER_GRID_TILE)
+#define PLAYER_GRID_MAX_TILE_DIMENSION 128
+#define PLAYER_GRID_MAX_TILES (PLAYER_GRID_MAX_TILE_DIMENSION*PLAYER_GRID_MAX_TILE_DIMENSION)
+#define PLAYER_GRID_TILES_PER_PLAYER 4 // A reach box is at most 4 cells wide, so it spans at most 2 tiles per side
+#define PLAYER_GRID_ENTRIES_PER_PLAYER 16
+#define PLAYER_GRID_MAX_BLOCK_DIMENSION 16
+	float cell_size;
+	float inv_cell_size;
+	int columns; // Of cells over the whole playzone
+	int rows;
+	int tile_columns;
+	int tile_rows;
+	int active_tile_count;
+	float *player_radius;
+	Vector2 *player_path; // MAX_BULLET_TICK_DIVISOR + 1 per player: the position at the start of each tick of the bullet window, then at its end
+	Vector2 *player_path_min; // Box around the path
+	Vector2 *player_path_max;
+	int *active_tiles; // Index in tile_slot of each active tile
+	int *cell_start; // PLAYER_GRID_TILE_CELLS for each active tile, in order of activation, and one past the end
+	int *entries;
+
+	// NOTE(jakob): Conservative advancement. block_clearance is the Chebyshev
+	// distance in blocks from each block to the nearest block touched by a
+	// living player's reach this window, using the largest reach for every
+	// player, with a border of unreachable blocks around it. A block is one
+	// tile, or several in arenas too wide for PLAYER_GRID_MAX_BLOCK_DIMENSION
+	// tiles. player_travel only grows: each bullet tick it adds the longest
+	// path of any living player in the window, summing |dx| + |dy| per tick,
+	// and how much the largest reach grew.
+	int block_cells; // Per side of a block
+	int block_columns;
+	int block_rows;
+	float max_player_reach;
+	double player_travel;
+	uint8_t block_clearance[(PLAYER_GRID_MAX_BLOCK_DIMENSION + 2)*(PLAYER_GRID_MAX_BLOCK_DIMENSION + 2)];
+
+	int tile_slot[PLAYER_GRID_MAX_TILES]; // Index of the tile among the active tiles, or -1; set to -1 by sim_reset
+} Player_Grid;
+
+// NOTE(jakob): Sweep-and-prune over the players' x extents. The order is kept
+// between ticks, so re-sorting it is an insertion sort over a nearly sorted
+// list; only pairs whose x extents overlap reach the narrowphase.
+typedef struct Player_Pair {
+	int player_1_index;
+	int player_2_index;
+} Player_Pair;
+
+typedef struct Player_Sweep {
+	int *order; // Of the living players
+	float *min_x;
+	float *max_x;
+	float *y;
+	float *radius; // Per player, refreshed by the fixed tick whenever the player's energy changes
+	int *pair_sort_counts;
+	int pair_count;
+	int pair_capacity;
+	Player_Pair *pairs;
+	Player_Pair *pairs_scratch;
+} Player_Sweep;
+
+// NOTE(jakob): Player overlaps are resolved by projecting positions apart
+// along each contact normal, with the push accumulated per contact and
+// clamped to stay non-negative. The contacts are kept between ticks (sorted
+// by pair, like the sweep output), so a pair that stays pressed together
+// starts from most of last tick's push instead of from scratch. Contacts are
+// grouped into islands of players that touch, and each island iterates until
+// its own correction settles, so one deep pile-up does not make the whole
+// field iterate. Within an island, a contact is skipped while neither of its
+// players has moved since it was last solved.
+//
+// Every tick, the contacts are also greedily colored in pair order so that no
+// two contacts of a color share a player. Each iteration solves the colors in
+// order, and the contacts of one color touch disjoint players, so a color is
+// split across the workers as is. Bullet rings that bounces set off are spawned
+// on one thread after each color, in contact order. The result is the same for
+// any worker count. A contact that finds no free color goes into a last batch
+// that is solved on one thread.
+//
+// The response differs from the old pair loop on purpose. Positions are only
+// pushed apart, and a pair bounces once per tick, in the first iteration, and
+// only while its players are closing. The old loop set a colliding pair to its
+// predicted positions, which the motion step then advanced again, so the pair
+// moved two steps that tick. It bounced every overlapping pair, which turned
+// pairs that were already separating back toward each other. Its 8 passes also
+// always stopped after the first, since the overlap it summed was never
+// positive. Players now stay in gentle contact more often where they used to
+// be flung apart.
+typedef struct Player_Contact {
+	int player_1_index;
+	int player_2_index;
+	float impulse; // Accumulated separating push, in pixels
+	uint32_t solved_stamp;
+	int island; // Root player of the contact's island
+	int color;
+	float push; // How far the last solve moved the players
+	int rings; // Bit 0 and 1: player 1 and 2 hit hard enough to spawn a ring, which is done after the batch
+} Player_Contact;
+
+typedef struct Player_Contacts {
+#define PLAYER_CONTACT_MAX_ITERATIONS 4
+#define PLAYER_CONTACT_WARM_START 0.8f
+#define PLAYER_CONTACT_TOLERANCE 1.0f // An island has settled when no push changes by more, in pixels
+#define PLAYER_CONTACT_MAX_COLORS 64 // Colors past this go into one batch solved on one thread
+#define MIN_CONTACTS_PER_WORKER 64
+	int count;
+	int previous_count;
+	int capacity;
+	Player_Contact *contacts;
+	Player_Contact *previous;
+
+	uint32_t *moved_stamp; // Per player, the solve that last moved it noticeably
+
+	int *island_parent; // Union-find over players
+	int *island_start; // Contacts of island root r are island_contacts[island_start[r]..island_start[r + 1]]
+	int *island_contacts;
+	int island_count;
+	int *island_roots; // Of the islands with contacts, in root order; the solve moves the unsettled ones to the front
+	bool *island_settled; // Per root
+
+	uint64_t *player_colors; // Per player, the colors of its contacts
+	int color_count; // Including the single-thread batch, if it is used
+	int color_start[PLAYER_CONTACT_MAX_COLORS + 2]; // Contacts of color c are color_contacts[color_start[c]..color_start[c + 1]]
+	int *color_contacts;
+} Player_Contacts;
+
+// NOTE(jakob): Marks the players a grid query has already returned
+typedef struct Player_Grid_Query {
+	uint32_t stamp;
+	uint32_t *stamps;
+	int *candidates;
+} Player_Grid_Query;
+
+// NOTE(jakob): The broadphase of bullet annihilation. The live bullets are
+// counting sorted by the cell of their position at the end of the tick, in
+// bullet order within a cell, so pairs are found in the same order for any
+// worker count and on every run. A cell is at least one bullet diameter
+// wide, so a bullet can only touch bullets in its own and the 8 neighbouring
+// cells.
+typedef struct Bullet_Grid {
+#define BULLET_GRID_MAX_DIMENSION 128
+#define BULLET_GRID_MAX_CELLS (BULLET_GRID_MAX_DIMENSION*BULLET_GRID_MAX_DIMENSION)
+	float cell_size;
+	float inv_cell_size;
+	int columns;
+	int rows;
+	int bullet_count;
+	int bullet_capacity;
+
+	// In bullet order
+	int *cell;
+	int *volley_index;
+	int *lane;
+	Vector2 *position;
+
+	// In cell order
+	int *sorted; // Index into the bullet order arrays
+	int *owner;
+	int *owner_run_end; // End of the run of bullets of the same owner in the cell
+	Vector2 *sorted_position;
+	bool *annihilated;
+
+	int cell_start[BULLET_GRID_MAX_CELLS + 1];
+} Bullet_Grid;
+
+typedef struct Collision_Stats {
+	int bullet_checks; // Live bullets moved and tested
+	int bullet_checks_skipped; // Live bullets in volleys that cannot hit anything yet
+	int bullet_pair_tests;
+	int bullet_pair_tests_skipped;
+	int bullet_annihilation_tests; // Bullet pairs in neighbouring cells that were tested
+	int bullets_annihilated;
+	int bullets_stopped_by_obstacles;
+	int player_contacts;
+	int player_islands;
+	int player_contact_colors;
+	int player_solver_iterations; // Summed over islands
+	int player_contact_solves;
+	int player_contact_solves_skipped; // By islands that settled early
+} Collision_Stats;
+
+typedef struct Bullet_Hit {
+	int volley_index;
+	int lane;
+	int opponent_index;
+	float bullet_speed;
+	Vector2 bullet_position;
+	Vector2 opponent_position;
+} Bullet_Hit;
+
+typedef struct Bullet_Worker {
+	Player_Grid_Query query;
+	Collision_Stats stats;
+	int hit_count;
+	int hit_capacity;
+	Bullet_Hit *hits;
+} Bullet_Worker;
+
+// NOTE(jakob): The bullet update runs in two phases. Workers evaluate and
+// test a contiguous range of volleys each, only reading the players and
+// writing hit records into their own hit buffer and the alive bits of their
+// own volleys. The hits are then applied on one thread
+// in bullet order, so the result is the same for any worker count.
+typedef struct Bullet_Update {
+#define MIN_BULLETS_PER_WORKER 512
+	struct Sim_State *sim;
+	int volley_count;
+	int worker_count;
+	uint32_t window_begin; // First tick of the bullet window being stepped
+	uint32_t lifetime_ticks;
+	int worker_volley_begin[MAX_WORKERS + 1]; // Split so workers get about as many awake bullets each
+	Bullet_Worker workers[MAX_WORKERS];
+} Bullet_Update;
+
+typedef enum Sim_Event_Type {
+	SIM_EVENT_HIT, // A bullet of other_player_index hit player_index
+	SIM_EVENT_POP, // player_index fired a volley of count bullets
+	SIM_EVENT_RING, // A hit ring of player_index's color at position, rotated by angle
+	SIM_EVENT_DEATH, // player_index was killed by other_player_index
+	SIM_EVENT_WIN, // player_index is the last one standing
+	SIM_EVENT_ANNIHILATION, // Bullets of player_index and other_player_index cancelled out at position, along angle
+} Sim_Event_Type;
+
+typedef struct Sim_Event {
+	Sim_Event_Type type;
+	int player_index;
+	int other_player_index;
+	int count;
+	float angle;
+	Vector2 position;
+} Sim_Event;
+
+typedef void (* Sim_Event_Callback)(struct Sim_State *sim, const Sim_Event *events, int count, void *user_data);
+
+typedef struct Sim_Event_Consumer {
+	Sim_Event_Callback callback;
+	void *user_data;
+} Sim_Event_Consumer;
+
+// NOTE(jakob): The fixed tick only changes simulation state. Everything it
+// would otherwise do to the outside world (sounds, rings, slow motion) is
+// appended here as an event and handed to the consumers after the tick, so a
+// headless server, a replay writer or a bot can take the place of the
+// presentation. The buffer keeps its memory between ticks, so appending an
+// event does not allocate once the buffer has grown to the busiest tick.
+typedef struct Sim_Event_Queue {
+#define MAX_SIM_EVENT_CONSUMERS 4
+	uint32_t tick; // The tick the events happened in
+	int count;
+	int capacity;
+	Sim_Event *events;
+
+	int consumer_count;
+	Sim_Event_Consumer consumers[MAX_SIM_EVENT_CONSUMERS];
+} Sim_Event_Queue;
+
+typedef struct Sim_State {
+	Game_Parameters params;
+	Sim_Arena arena;
+
+	int triumphant_player;
+	int num_dead_players;
+	float sim_time; // Advanced by the fixed tick only
+	uint32_t tick_count; // Fixed ticks since the match started
+
+	Virtual_Input_Device_State local_inputs[MAX_LOCAL_PLAYERS];
+
+	int player_capacity;
+	Player *players;
+	Player_Bot *player_bots;
+	float *player_comeback_factor; // Per player, updated when its health changes
+
+	// NOTE(jakob): The components of each player (see jj_entities.h). The
+	// systems that only concern living players query ENTITY_ALIVE instead of
+	// checking every player's health.
+	Entity_Set entities;
+	Bullet_Pool bullets;
+	Player_Grid player_grid;
+	Bullet_Grid bullet_grid;
+	Player_Sweep player_sweep;
+	Player_Contacts player_contacts;
+	Collision_Stats collision_stats;
+	Worker_Pool workers;
+	Bullet_Update bullet_update;
+	Sim_Event_Queue events;
+	Obstacle_Field obstacles; // Loaded by the front-end before sim_reset and kept between matches
+
+	// NOTE(jakob): The pair and opponent tests of this match, picked by
+	// sim_reset for the player count. generic_lobby is set by sim_init when
+	// JJ_SIM_GENERIC is set in the environment, and keeps every match on the
+	// generic tests, for comparing them.
+	int lobby_players; // The player count the tests are written out for, or 0 for the generic ones
+	bool generic_lobby;
+
+	uint64_t random_state;
+} Sim_State;
+
+extern const Game_Parameters sim_default_params;
+
+// NOTE(jakob): Whether the library was built with JJ_DETERMINISTIC, i.e.
+// with the integer trigonometry of jj_fixed.h
+extern const bool sim_deterministic;
+
+// NOTE(jakob): Expects sim to be zeroed. Starts worker_count simulation
+// threads, or when worker_count is 0, JJ_SIM_THREADS of them if that is set
+// in the environment and otherwise one per core, up to 8.
+void sim_init(Sim_State *sim, int worker_count);
+
+void sim_shutdown(Sim_State *sim);
+
+// NOTE(jakob): Starts a new match. Keeps random_state, the event consumers
+// and the memory of the previous match.
+void sim_reset(Sim_State *sim, const Game_Parameters *params, Sim_Arena arena);
+
+// NOTE(jakob): The name of the pair and opponent tests the current match uses
+const char *sim_lobby_variant_name(const Sim_State *sim);
+
+void sim_set_arena(Sim_State *sim, Sim_Arena arena);
+
+// NOTE(jakob): Advances the match by TIME_STEP_FIXED and queues the events of
+// the tick; sim_events_dispatch hands them to the consumers.
+void sim_update_fixed(Sim_State *sim);
+
+bool sim_is_game_over(Sim_State *sim);
+
+// NOTE(jakob): Hash of everything the fixed tick reads and writes, for
+// checking replays and network peers. With JJ_DETERMINISTIC, runs fed the
+// same inputs have the same hash after every tick on any x86-64 build that
+// passes the float checks in jj_fixed.h.
+uint64_t sim_state_hash(Sim_State *sim);
+
+void sim_events_dispatch(Sim_State *sim);
+
+bool sim_events_add_consumer(Sim_Event_Queue *queue, Sim_Event_Callback callback, void *user_data);
+
+void sim_events_remove_consumer(Sim_Event_Queue *queue, Sim_Event_Callback callback, void *user_data);
+
+float calculate_player_radius(Player *player, Game_Parameters *game_params);
+
+void calculate_bullet_count_and_angle_span(Player *player, Game_Parameters *game_params, int *count_out, float *angle_span_out);
+
+void spawn_bullet_ring_ex(Player *player, Sim_State *sim, int count, float speed, float spin);
+
+Bullet_Handle bullet_pool_handle(Bullet_Pool *pool, int volley_index, int lane);
+
+// NOTE(jakob): Returns the current index of the bullet's volley, or -1 if the
+// bullet is gone
+int bullet_pool_lookup(Bullet_Pool *pool, Bullet_Handle handle);
+
+bool bullet_pool_lane_alive(Bullet_Pool *pool, int volley_index, int lane);
+
+// NOTE(jakob): Bit lane%64 of word lane/64 is set while the lane lives; walk
+// them with bits_next
+uint64_t *bullet_pool_alive_words(Bullet_Pool *pool, int volley_index);
+
+// NOTE(jakob): Time since the volley's first step, as of the start of tick
+float bullet_pool_age(Bullet_Pool *pool, int volley_index, uint32_t tick);
+
+// NOTE(jakob): The bullet's position and velocity as of the start of any
+// tick, in closed form, so this costs the same for any tick
+void bullet_pool_state(Bullet_Pool *pool, int volley_index, int lane, uint32_t tick, Vector2 *position_out, Vector2 *velocity_out);
+
+// NOTE(jakob): A bound on the distance of every lane of the volley from its
+// origin as of the start of tick, so a whole volley can be culled at once
+float bullet_pool_volley_reach(Bullet_Pool *pool, int volley_index, uint32_t tick);
+
+uint64_t xorshift64(uint64_t *state);
+
+float random_01(uint64_t *random_state);
+
+#endif
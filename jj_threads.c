@@ -0,0 +1,119 @@
+#include "jj_threads.h"
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+int cpu_count(void) {
+#ifdef _WIN32
+	return pthread_num_processors_np();
+#else
+	long count = sysconf(_SC_NPROCESSORS_ONLN);
+	return count > 0 ? (int)count : 1;
+#endif
+}
+
+static void *worker_thread_main(void *argument) {
+	Worker_Thread *worker = argument;
+	Worker_Pool *pool = worker->pool;
+
+	unsigned int seen_generation = 0;
+
+	pthread_mutex_lock(&pool->mutex);
+
+	for (;;) {
+		while (pool->generation == seen_generation && !pool->quit) {
+			pthread_cond_wait(&pool->start_condition, &pool->mutex);
+		}
+
+		if (pool->quit) break;
+
+		seen_generation = pool->generation;
+
+		if (worker->worker_index < pool->job_worker_count) {
+			Worker_Job job = pool->job;
+			void *user_data = pool->user_data;
+			int job_worker_count = pool->job_worker_count;
+
+			pthread_mutex_unlock(&pool->mutex);
+			job(user_data, worker->worker_index, job_worker_count);
+			pthread_mutex_lock(&pool->mutex);
+
+			if (--pool->pending == 0) {
+				pthread_cond_signal(&pool->done_condition);
+			}
+		}
+	}
+
+	pthread_mutex_unlock(&pool->mutex);
+
+	return NULL;
+}
+
+void worker_pool_init(Worker_Pool *pool, int worker_count) {
+	if (worker_count < 1) worker_count = 1;
+	if (worker_count > MAX_WORKERS) worker_count = MAX_WORKERS;
+
+	pool->worker_count = worker_count;
+	pool->generation = 0;
+	pool->pending = 0;
+	pool->quit = false;
+
+	pthread_mutex_init(&pool->mutex, NULL);
+	pthread_cond_init(&pool->start_condition, NULL);
+	pthread_cond_init(&pool->done_condition, NULL);
+
+	for (int worker_index = 1; worker_index < worker_count; ++worker_index) {
+		Worker_Thread *worker = &pool->threads[worker_index];
+		worker->pool = pool;
+		worker->worker_index = worker_index;
+
+		if (pthread_create(&worker->thread, NULL, worker_thread_main, worker) != 0) {
+			// NOTE(jakob): Run with the threads we got
+			pool->worker_count = worker_index;
+			break;
+		}
+	}
+}
+
+void worker_pool_run(Worker_Pool *pool, Worker_Job job, void *user_data, int worker_count) {
+	if (worker_count > pool->worker_count) worker_count = pool->worker_count;
+	if (worker_count < 1) worker_count = 1;
+
+	if (worker_count == 1) {
+		job(user_data, 0, 1);
+		return;
+	}
+
+	pthread_mutex_lock(&pool->mutex);
+	pool->job = job;
+	pool->user_data = user_data;
+	pool->job_worker_count = worker_count;
+	pool->pending = worker_count - 1;
+	++pool->generation;
+	pthread_cond_broadcast(&pool->start_condition);
+	pthread_mutex_unlock(&pool->mutex);
+
+	job(user_data, 0, worker_count);
+
+	pthread_mutex_lock(&pool->mutex);
+	while (pool->pending > 0) {
+		pthread_cond_wait(&pool->done_condition, &pool->mutex);
+	}
+	pthread_mutex_unlock(&pool->mutex);
+}
+
+void worker_pool_shutdown(Worker_Pool *pool) {
+	pthread_mutex_lock(&pool->mutex);
+	pool->quit = true;
+	pthread_cond_broadcast(&pool->start_condition);
+	pthread_mutex_unlock(&pool->mutex);
+
+	for (int worker_index = 1; worker_index < pool->worker_count; ++worker_index) {
+		pthread_join(pool->threads[worker_index].thread, NULL);
+	}
+
+	pthread_mutex_destroy(&pool->mutex);
+	pthread_cond_destroy(&pool->start_condition);
+	pthread_cond_destroy(&pool->done_condition);
+}
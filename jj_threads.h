@@ -0,0 +1,42 @@
+#ifndef JJ_THREADS_H
+#define JJ_THREADS_H
+
+#include <pthread.h>
+
+typedef void (* Worker_Job)(void *user_data, int worker_index, int worker_count);
+
+typedef struct Worker_Thread {
+	struct Worker_Pool *pool;
+	int worker_index;
+	pthread_t thread;
+} Worker_Thread;
+
+// NOTE(jakob): A fixed set of threads that all run the same job and are waited
+// for together. The calling thread acts as worker 0, so a pool with one worker
+// starts no threads at all.
+typedef struct Worker_Pool {
+#define MAX_WORKERS 16
+	int worker_count;
+	Worker_Thread threads[MAX_WORKERS];
+	pthread_mutex_t mutex;
+	pthread_cond_t start_condition;
+	pthread_cond_t done_condition;
+	unsigned int generation;
+	int pending;
+	bool quit;
+	Worker_Job job;
+	void *user_data;
+	int job_worker_count;
+} Worker_Pool;
+
+int cpu_count(void);
+
+void worker_pool_init(Worker_Pool *pool, int worker_count);
+
+// NOTE(jakob): Runs job on the first worker_count workers (clamped to the pool
+// size) and returns when all of them have finished.
+void worker_pool_run(Worker_Pool *pool, Worker_Job job, void *user_data, int worker_count);
+
+void worker_pool_shutdown(Worker_Pool *pool);
+
+#endif
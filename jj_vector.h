@@ -0,0 +1,43 @@
+#ifndef JJ_VECTOR_H
+#define JJ_VECTOR_H
+
+// NOTE(jakob): The few raymath functions the simulation uses, written the same
+// way so results do not change, for building it without raylib.
+
+static inline float Lerp(float start, float end, float amount) {
+	return start + amount*(end - start);
+}
+
+static inline Vector2 Vector2Add(Vector2 v1, Vector2 v2) {
+	return (Vector2){v1.x + v2.x, v1.y + v2.y};
+}
+
+static inline Vector2 Vector2AddValue(Vector2 v, float add) {
+	return (Vector2){v.x + add, v.y + add};
+}
+
+static inline Vector2 Vector2Subtract(Vector2 v1, Vector2 v2) {
+	return (Vector2){v1.x - v2.x, v1.y - v2.y};
+}
+
+static inline Vector2 Vector2SubtractValue(Vector2 v, float sub) {
+	return (Vector2){v.x - sub, v.y - sub};
+}
+
+static inline Vector2 Vector2Scale(Vector2 v, float scale) {
+	return (Vector2){v.x*scale, v.y*scale};
+}
+
+static inline float Vector2Length(Vector2 v) {
+	return sqrtf((v.x*v.x) + (v.y*v.y));
+}
+
+static inline float Vector2LengthSqr(Vector2 v) {
+	return (v.x*v.x) + (v.y*v.y);
+}
+
+static inline float Vector2DotProduct(Vector2 v1, Vector2 v2) {
+	return (v1.x*v2.x + v1.y*v2.y);
+}
+
+#endif
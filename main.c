@@ -6,26 +6,21 @@
 #include <time.h>
 
 #include <raylib.h>
+#include <raymath.h>
 
 #ifdef __APPLE__
 #include "CoreFoundation/CoreFoundation.h"
 #endif
 
-// Unity-build
-#include "jj_math.c"
+// NOTE(jakob): The window, audio, input and drawing. The game itself is
+// libjj_sim (jj_sim.c), built and linked separately.
+#include "jj_sim.h"
 
 #define FONT_SPACING_FOR_SIZE 0.12f
 
 
-#define MINIMUM(a, b) ((a) < (b) ? (a) : (b))
-#define MAXIMUM(a, b) ((a) > (b) ? (a) : (b))
-
-#define UNUSED(var) ((void)(var))
-
 static const char *title = "Juelsminde Joust";
 
-#define TIME_STEP_FIXED 0.01f
-
 typedef struct View {
 	float width;
 	float height;
@@ -34,34 +29,6 @@ typedef struct View {
 	float screen_width;
 	float screen_height;
 } View;
-
-typedef struct Bullet {
-	Vector2 position;
-	Vector2 velocity;
-	float time;
-	float spin;
-} Bullet;
-
-typedef struct Virtual_Input_Button {
-	bool is_down;
-	bool is_pressed;
-	bool is_released;
-	// TODO(jakob): Make possible to detect multiple keystrokes per frame (state_transition_count) 
-	// int state_transition_count;
-} Virtual_Input_Button;
-
-enum {
-	VIRTUAL_BUTTON_ACTION = 0,
-	VIRTUAL_BUTTON_MENU = 1,
-
-	VIRTUAL_BUTTON_COUNT
-};
-
-typedef struct Virtual_Input_Device_State {
-	Vector2 direction; // NOTE(jakob): Valid in unit circle
-	Virtual_Input_Button buttons[VIRTUAL_BUTTON_COUNT];
-} Virtual_Input_Device_State;
-
 typedef struct Virtual_Input_Key_Map {
 	KeyboardKey key_left;
 	KeyboardKey key_right;
@@ -90,32 +57,22 @@ typedef struct Virtual_Input {
 } Virtual_Input;
 
 
+// NOTE(jakob): What the front-end shows and plays for each player
 typedef struct Player_Parameters {
-	Virtual_Input_Device *input_device;
 	const char *key_text;
 	Sound sound_pop;
 	Sound sound_hit;
 	Color color;
+	char name[24];
 } Player_Parameters;
 
-
-typedef struct Player {
-	Vector2 position;
-	Vector2 velocity;
-	float angular_velocity;
-	float shoot_angle;
-	int health;
-	float energy;
-	float controls_text_timeout;
-	float shoot_time_out;
+// NOTE(jakob): The per-player state only the presentation reads, kept apart
+// from Player so the simulation's players stay packed together
+typedef struct Player_Presentation {
 	float hit_animation_t;
-	float shoot_charge_t;
 	float death_animation_t;
-#define MAX_ACTIVE_BULLETS 2048
-	int active_bullets;
-	Bullet bullets[MAX_ACTIVE_BULLETS];
-	Player_Parameters params;
-} Player;
+	float controls_text_timeout;
+} Player_Presentation;
 
 typedef struct Ring {
 	Vector2 position;
@@ -144,8 +101,11 @@ enum Menu_Action {
 	MENU_ACTION_FULLSCREEN_TOGGLE,
 };
 
+// NOTE(jakob): An int range wraps around at its ends, unless doubling_from
+// is set. Then it steps by 1 up to doubling_from, doubles and halves above
+// it, and stops at its ends, so a large max is a few presses away.
 typedef union Value_Range {
-	struct {int *value, min, max;} int_range;
+	struct {int *value, min, max, doubling_from;} int_range;
 	struct {float *value, min, max;} float_range;
 } Value_Range;
 
@@ -170,37 +130,22 @@ typedef struct Menu {
 	unsigned int selected_index;
 } Menu;
 
-typedef struct Game_Parameters {
-	int num_players;
-	int starting_health;
-	float minimum_radius;
-	float acceleration_force;
-	float friction;
-	float comeback_base_factor; // TODO(jakob) spell comeback -> comeback
-
-	float bullet_energy_cost_ring;
-	float bullet_energy_cost_fan;
-	float bullet_radius;
-	float bullet_time_end_fade;
-	float bullet_time_begin_fade;
-
-	float slowdowns_per_second;
-	float full_charges_per_second;
-
-	float slow_motion_slowest_factor;
-} Game_Parameters;
-
 typedef struct Game_State {
 	bool running;
 
 	View view;
+	Vector2 camera; // World position of the top left corner of the screen
+	int arena_screens; // Of the current game, per side
 
 	Virtual_Input input;
-	Game_Parameters params;
+	Sim_State sim;
 
 	Sound sound_win;
-	int triumphant_player;
-	int num_dead_players;
+	Wave wave_pop[2];
+	Wave wave_hit[2];
+	int player_params_capacity;
+	Player_Parameters *player_params;
+	Player_Presentation *player_presentation; // Reserved with player_params
 	
 	float title_alpha;
 	float time_scale;
@@ -210,11 +155,10 @@ typedef struct Game_State {
 	float time_step_t;
 	float slow_motion_t;
 
-#define MAX_ACTIVE_PLAYERS 4
-// #define NUM_PLAYERS 3
-	Player players[MAX_ACTIVE_PLAYERS];
+	// NOTE(jakob): Rings are entities of their own set; an entity with
+	// ENTITY_RING is a live slot of rings
 #define MAX_ACTIVE_RINGS 128
-	int active_rings;
+	Entity_Set ring_entities;
 	Ring rings[MAX_ACTIVE_RINGS];
 	int color_red;
 	int color_green;
@@ -222,216 +166,273 @@ typedef struct Game_State {
 
 	uint32_t ipv4_host_address;
 
-	uint64_t random_state;
-
 	bool show_menu;
 	float menu_item_cooldown;
 	Menu *menu;
 } Game_State;
 
-static Game_Parameters game_params_for_new_game = {
-	.num_players = 4,
+// NOTE(jakob): Starts out as sim_default_params; the settings menu edits it
+static Game_Parameters game_params_for_new_game;
 
-	.starting_health = 2,
-	.minimum_radius = 32.0f,
-	.acceleration_force = 1100.0f,
-	.friction = 0.94f,
+// NOTE(jakob): The arena is this many screens wide and high. With more than
+// one, the camera follows the players.
+static int arena_screens_for_new_game = 1;
 
-	.bullet_energy_cost_ring = 2.5f,
-	.bullet_energy_cost_fan = 4.0f,
-	.bullet_radius = 15.0f,
-	.bullet_time_end_fade = 7.0f,
-	.bullet_time_begin_fade = (7.0f-0.4f),
 
-	.slowdowns_per_second = 1.0f,
-	.full_charges_per_second = 1.5f,
 
-	.comeback_base_factor = 1.0f, // NOTE(jakob & patrick): energy_gained = xxxx + comeback_base_factor*(1.0f - ((float)health/(float)starting_health))
-	.slow_motion_slowest_factor = 0.3f,
-};
+void spawn_ring(Game_State *game_state, Vector2 position, int player_index, float ring_angle) {
 
+	Entity_Set *ring_entities = &game_state->ring_entities;
 
-float calculate_player_radius(Player *player, Game_Parameters *game_params) {
-	return game_params->minimum_radius + player->energy*1.2f;
-}
+	Entity_Query free_rings = entity_query(ring_entities, 0, ENTITY_MASK(ENTITY_RING));
+	int ring_index = entity_query_next(&free_rings);
 
-float calculate_player_comeback_factor(Player *player, Game_Parameters *game_params) {
-	float result = game_params->comeback_base_factor*(1.0f - ((float)player->health / (float)game_params->starting_health));
-	return result;
-}
+	if (ring_index >= 0 && ring_index < MAX_ACTIVE_RINGS) {
 
+		game_state->rings[ring_index] = (Ring){
+			.position = position,
+			.player_index = player_index,
+			.t = 0.0f,
+			.angle = ring_angle,
+		};
 
-bool hit_is_hard_enough(float hit) {
+		entity_add(ring_entities, ring_index, ENTITY_RING);
+	}
 
-	return 200.0f <= fabs(hit);
 }
 
+// NOTE(jakob): The consumer that turns simulation events into sound and
+// effects for the local window. It runs once per fixed tick, so it also fades
+// the title as the players start moving.
+static void game_present_sim_events(Sim_State *sim, const Sim_Event *events, int count, void *user_data) {
+	Game_State *game_state = user_data;
+
+	for (int event_index = 0; event_index < count; ++event_index) {
+		const Sim_Event *event = &events[event_index];
+		Player_Presentation *presentation = &game_state->player_presentation[event->player_index];
+		Player_Parameters *params = &game_state->player_params[event->player_index];
+
+		switch (event->type) {
+			case SIM_EVENT_HIT: {
+				PlaySound(params->sound_hit);
+				presentation->hit_animation_t = 0.0f;
+			} break;
+
+			case SIM_EVENT_POP: {
+				PlaySound(params->sound_pop);
+			} break;
+
+			case SIM_EVENT_RING: {
+				spawn_ring(game_state, event->position, event->player_index, event->angle);
+			} break;
+
+			case SIM_EVENT_DEATH: {
+				presentation->death_animation_t = 0.0f;
+
+				// Start dramatic slow motion
+				game_state->slow_motion_t = 0.0f;
+			} break;
+
+			case SIM_EVENT_WIN: {
+				game_state->slow_motion_t = 1.0f;
+				game_state->time_scale = 0.25f;
+				PlaySound(game_state->sound_win);
+			} break;
+
+			case SIM_EVENT_ANNIHILATION: {
+				spawn_ring(game_state, event->position, event->player_index, event->angle);
+			} break;
+		}
+	}
 
-uint64_t xorshift64(uint64_t *state)
-{
-	uint64_t x = *state;
-	x ^= x << 13;
-	x ^= x >> 7;
-	x ^= x << 17;
-	return *state = x;
+	Entity_Query living = entity_query(&sim->entities, ENTITY_MASK(ENTITY_ALIVE), 0);
+	for (int player_index; (player_index = entity_query_next(&living)) >= 0;) {
+		Player *player = sim->players + player_index;
+
+		if (game_state->title_alpha > 0) {
+			game_state->title_alpha -= Vector2Length(player->velocity)*0.0001f;
+		}
+	}
 }
 
-float random_01(uint64_t *random_state) {
+void draw_text_shadowed(Font font, const char *text, Vector2 position, float font_size, float font_spacing, Color front_color, Color background_color) {
+	DrawTextEx(font, text, Vector2Add(position, (Vector2){3, 3}), font_size, font_spacing, background_color);
+	DrawTextEx(font, text, position, font_size, font_spacing, front_color);
+}
 
-	union {
-		uint32_t as_int;
-		float as_float;
-	} val;
+static const Virtual_Input_Key_Map global_key_maps[] = {
+	{
+		KEY_LEFT,
+		KEY_RIGHT,
+		KEY_UP,
+		KEY_DOWN,
+		KEY_RIGHT_CONTROL,
+		KEY_ESCAPE,
+	},
+	{
+		KEY_A,
+		KEY_D,
+		KEY_W,
+		KEY_S,
+		KEY_LEFT_CONTROL,
+		KEY_ESCAPE,
+	},
+	{
+		KEY_J,
+		KEY_L,
+		KEY_I,
+		KEY_K,
+		KEY_U,
+		KEY_ESCAPE,
+	},
+	{
+		KEY_KP_4,
+		KEY_KP_6,
+		KEY_KP_8,
+		KEY_KP_5,
+		KEY_KP_7,
+		KEY_ESCAPE,
+	},
+};
 
-	val.as_int = (xorshift64(random_state)&((1 << 23)-1)) | (127 << 23);
+static const char *global_key_map_texts[] = {
+	"Arrow Keys + Right CTRL",
+	"W,A,S,D + Left CTRL",
+	"I,J,K,L + U",
+	"Num 8,4,5,6 + Num 7",
+};
 
-	float result = val.as_float - 1.0f;
+static const char *global_player_names[] = {
+	"Orange Player",
+	"Blue Player",
+	"Green Player",
+	"Purple Player",
+};
 
-	return result;
-}
+static const Color global_player_colors[] = {
+	{240, 120, 0, 255},
+	{0, 120, 240, 255},
+	{40, 220, 80, 255},
+	{180, 50, 220, 255},
+};
 
+// NOTE(jakob): The first four players keep their hand-picked colors and
+// sounds. Later players get hues spread by the golden angle and the two
+// sound sets at varying pitch.
+static void player_params_init(Game_State *game_state, int player_index) {
+	Player_Parameters *params = &game_state->player_params[player_index];
 
-void spawn_bullet_ring_ex(Player *player, Game_State *game_state, int count, float speed, float spin) {
-	Game_Parameters *game_params = &game_state->params;
+	*params = (Player_Parameters){0};
 
-	if (player->active_bullets + count > MAX_ACTIVE_BULLETS) {
-		count = MAX_ACTIVE_BULLETS - player->active_bullets;
-	}
+	int sound_set = ((player_index + 1)/2) % 2;
+	params->sound_pop = LoadSoundFromWave(game_state->wave_pop[sound_set]);
+	params->sound_hit = LoadSoundFromWave(game_state->wave_hit[sound_set]);
 
-	player->energy -= count * game_params->bullet_energy_cost_ring;
+	if (player_index < MAX_LOCAL_PLAYERS) {
+		params->color = global_player_colors[player_index];
+		snprintf(params->name, sizeof(params->name), "%s", global_player_names[player_index]);
+	}
+	else {
+		float hue = fmodf((float)player_index*137.508f, 360.0f);
+		params->color = ColorFromHSV(hue, 0.75f, 0.9f);
+		snprintf(params->name, sizeof(params->name), "Player %d", player_index + 1);
 
-	if (player->energy < 0) {
-		player->energy = 0.0f;
+		float pitch = 0.75f + 0.5f*fmodf((float)player_index*0.618034f, 1.0f);
+		SetSoundPitch(params->sound_pop, pitch);
+		SetSoundPitch(params->sound_hit, pitch);
 	}
+}
 
-	float angle_quantum = 2.0f*PI / (float)count;
+// NOTE(jakob): Players that already exist keep their parameters
+static void game_player_params_reserve(Game_State *game_state, int num_players) {
+	int old_capacity = game_state->player_params_capacity;
+	if (num_players <= old_capacity) return;
 
-	float angle = random_01(&game_state->random_state)*2.0f*PI;
+	REALLOC_ARRAY(game_state->player_params, num_players);
+	REALLOC_ARRAY(game_state->player_presentation, num_players);
+	game_state->player_params_capacity = num_players;
 
-	for (int i = 0; i < count; ++i) {
-		Bullet *bullet = &player->bullets[player->active_bullets + i];
-		bullet->position = player->position;
-		bullet->velocity = Vector2Scale((Vector2){cosf(angle), sinf(angle)}, speed);
-		bullet->time = 0;
-		bullet->spin = spin;
-		angle += angle_quantum;
+	for (int player_index = old_capacity; player_index < num_players; ++player_index) {
+		player_params_init(game_state, player_index);
 	}
-
-	player->active_bullets += count;
-
-	PlaySound(player->params.sound_pop);
 }
 
-void spawn_bullet_ring(Player *player, Game_State *game_state) {
-	Game_Parameters *game_params = &game_state->params;
-	float comeback_factor = calculate_player_comeback_factor(player, game_params);
-	int count = (int)((player->energy * (0.5f + 0.5f*comeback_factor)) / game_params->bullet_energy_cost_ring);
-	float speed = 50.0f + Vector2LengthSqr(player->velocity)/1565.0f;
-	float spin = 0.3f*player->angular_velocity;
-	spawn_bullet_ring_ex(player, game_state, count, speed, spin);
+static Sim_Arena game_arena_for_view(Game_State *game_state, View view) {
+	return (Sim_Arena){view.width*(float)game_state->arena_screens, view.height*(float)game_state->arena_screens};
 }
 
-void spawn_bullet_fan(Player *player, Game_Parameters *game_params, int count, float speed, float angle_span) {
-
-	if (player->active_bullets + count > MAX_ACTIVE_BULLETS) {
-		count = MAX_ACTIVE_BULLETS - player->active_bullets;
-	}
+// NOTE(jakob): Moves the camera the fraction t of the way towards centering
+// the living local players, or all living players when no local player is
+// left, and keeps it inside the arena
+static void game_update_camera(Game_State *game_state, float t) {
+	Sim_State *sim = &game_state->sim;
+	View view = game_state->view;
 
-	player->energy -= count * game_params->bullet_energy_cost_fan;
+	Vector2 sum = {0};
+	int count = 0;
 
-	if (player->energy < 0) {
-		player->energy = 0.0f;
+	for (int pass = 0; pass < 2 && count == 0; ++pass) {
+		uint32_t with = ENTITY_MASK(ENTITY_ALIVE) | (pass == 0 ? ENTITY_MASK(ENTITY_LOCAL) : 0);
+		Entity_Query living = entity_query(&sim->entities, with, 0);
+		for (int player_index; (player_index = entity_query_next(&living)) >= 0;) {
+			sum = Vector2Add(sum, sim->players[player_index].position);
+			++count;
+		}
 	}
 
-	float angle_quantum = angle_span / (float)count;
-
-	float angle = player->shoot_angle - 0.5f*angle_span + 0.5f*angle_quantum;
-
-	Vector2 quater_player_velocity = Vector2Scale(player->velocity, 0.25f);
-
-	for (int i = 0; i < count; ++i) {
-		Bullet *bullet = &player->bullets[player->active_bullets + i];
-		bullet->position = player->position;
-		bullet->velocity = Vector2Scale((Vector2){cosf(angle), sinf(angle)}, speed);
-		bullet->velocity = Vector2Add(bullet->velocity, quater_player_velocity);
-		bullet->time = 0;
-		bullet->spin = 0.3f*player->angular_velocity;
-		angle += angle_quantum;
+	Vector2 target = game_state->camera;
+	if (count > 0) {
+		target = Vector2Subtract(Vector2Scale(sum, 1.0f/(float)count), (Vector2){0.5f*view.width, 0.5f*view.height});
 	}
 
-	player->active_bullets += count;
-
-	PlaySound(player->params.sound_pop);
-}
-
-
-void spawn_ring(Game_State *game_state, Vector2 position, int player_index, float ring_angle) {
-
-	if (game_state->active_rings < MAX_ACTIVE_RINGS) {
-
-		game_state->rings[game_state->active_rings++] = (Ring){
-			.position = position,
-			.player_index = player_index,
-			.t = 0.0f,
-			.angle = ring_angle,
-		};
+	Vector2 camera = Vector2Add(game_state->camera, Vector2Scale(Vector2Subtract(target, game_state->camera), t));
 
-	}
+	camera.x = MAXIMUM(0.0f, MINIMUM(camera.x, sim->arena.width - view.width));
+	camera.y = MAXIMUM(0.0f, MINIMUM(camera.y, sim->arena.height - view.height));
 
+	game_state->camera = camera;
 }
 
-bool position_outside_playzone(Vector2 position, View view) {
-	return (
-		position.x < -100 ||
-		position.x >= view.width + 100 ||
-		position.y < -100 ||
-		position.y >= view.height + 100
-	);
+static Vector2 world_to_screen(Game_State *game_state, Vector2 position) {
+	return Vector2Scale(Vector2Subtract(position, game_state->camera), game_state->view.scale);
 }
 
-void draw_text_shadowed(Font font, const char *text, Vector2 position, float font_size, float font_spacing, Color front_color, Color background_color) {
-	DrawTextEx(font, text, Vector2Add(position, (Vector2){3, 3}), font_size, font_spacing, background_color);
-	DrawTextEx(font, text, position, font_size, font_spacing, front_color);
-}
+// NOTE(jakob): Whether a circle in world units may show on the screen
+static bool world_circle_visible(Game_State *game_state, Vector2 center, float radius) {
+	Vector2 camera = game_state->camera;
+	View view = game_state->view;
 
-static bool is_game_over(Game_State *game_state) {
-	return game_state->num_dead_players >= game_state->params.num_players - 1;
+	return center.x + radius >= camera.x && center.x - radius <= camera.x + view.width &&
+		center.y + radius >= camera.y && center.y - radius <= camera.y + view.height;
 }
 
 void game_reset(Game_State *game_state, View view) {
 
-	// Init game parameters
-	game_state->params = game_params_for_new_game;
-
 	game_state->show_menu = false;
-	game_state->triumphant_player = -1;
 	game_state->time_scale = 1.0f;
-	game_state->num_dead_players = 0;
 	game_state->title_alpha = 1.0f;
-	game_state->active_rings = 0;
+	entity_set_clear(&game_state->ring_entities, MAX_ACTIVE_RINGS);
 	game_state->game_play_time = 0.0f;
 	game_state->game_in_progress = true;
 
-	Game_Parameters *game_params = &game_state->params;
-
-	int column_count = game_params->num_players;
-	float column_width = view.width / (float)column_count;
-
-	for (int player_index = 0; player_index < game_params->num_players; ++player_index) {
-		Player *player = &game_state->players[player_index];
+	game_state->arena_screens = arena_screens_for_new_game;
+	sim_reset(&game_state->sim, &game_params_for_new_game, game_arena_for_view(game_state, view));
 
-		Vector2 screen_center = (Vector2){0.5f*view.width, 0.5f*view.height};
+	Game_Parameters *game_params = &game_state->sim.params;
 
-		Vector2 aim_dir = Vector2Subtract(screen_center, player->position);
-		aim_dir = Vector2NormalizeOrZero(aim_dir);
+	game_player_params_reserve(game_state, game_params->num_players);
 
-		memset(player, 0, (char *)&player->params - (char *)player);
-		player->position = (Vector2){ column_width*(player_index + 0.5f), view.height / 2.0f };
-		player->shoot_angle = atan2f(aim_dir.y, aim_dir.x);
-		player->health = game_params->starting_health;
-		player->hit_animation_t = 1.0f;
+	Entity_Query players = entity_query(&game_state->sim.entities, ENTITY_MASK(ENTITY_PLAYER), 0);
+	for (int player_index; (player_index = entity_query_next(&players)) >= 0;) {
+		Player_Parameters *params = &game_state->player_params[player_index];
+		params->key_text = entity_has(&game_state->sim.entities, player_index, ENTITY_LOCAL) ? global_key_map_texts[player_index] : NULL;
 
+		game_state->player_presentation[player_index] = (Player_Presentation){
+			.hit_animation_t = 1.0f,
+		};
 	}
+
+	game_update_camera(game_state, 1.0f);
 }
 
 void set_window_to_monitor_dimensions(void) {
@@ -468,46 +469,6 @@ View get_updated_view(void) {
 	return result;
 }
 
-static void calculate_bullet_count_and_angle_span(Player *player, Game_Parameters *game_params, int *count_out, float *angle_span_out) {
-	float narrow_angle_span = 2.0*PI / 60.0f;
-	float wide_angle_span = 2.0*PI / 4.0f;
-	float t = player->shoot_charge_t;
-	float comeback_factor = calculate_player_comeback_factor(player, game_params);
-	*count_out = (player->energy * (0.25f + 0.75f*comeback_factor)) / game_params->bullet_energy_cost_fan;
-	*angle_span_out = Lerp(wide_angle_span, narrow_angle_span, t);
-}
-
-float shortest_angle_difference(float a, float b) {
-	// NOTE(jakob & patrick): This assumes normalized angles between 0 and 2*PI
-	// assert(a >= 0.0f);
-	// assert(b >= 0.0f);
-	// assert(a <= 2*PI + 0.00001f);
-	// assert(b <= 2*PI + 0.00001f);
-
-	float angle_difference = b - a;
-
-	if (angle_difference > PI) {
-		angle_difference -= 2*PI;
-	} else if (angle_difference < -PI) {
-		angle_difference += 2*PI;
-	}
-
-	return angle_difference;
-}
-
-float lerp_angle(float a, float b, float t) {
-	float difference = shortest_angle_difference(a, b);
-	float result = a + t*difference;
-
-	if (result >= 2*PI) {
-		result -= 2*PI;
-	}
-	else if (result < 0.0f) {
-		result += 2*PI;
-	}
-	return result;
-}
-
 int menu_action_toggle_fullscreen(int change, char *user_data) {
 	UNUSED(change);
 	UNUSED(user_data);
@@ -556,41 +517,6 @@ static Vector2 interpolate_movement(Vector2 position, Vector2 velocity, float st
 	return result;
 }
 
-static const Virtual_Input_Key_Map global_key_maps[] = {
-	{
-		KEY_LEFT,
-		KEY_RIGHT,
-		KEY_UP,
-		KEY_DOWN,
-		KEY_RIGHT_CONTROL,
-		KEY_ESCAPE,
-	},
-	{
-		KEY_A,
-		KEY_D,
-		KEY_W,
-		KEY_S,
-		KEY_LEFT_CONTROL,
-		KEY_ESCAPE,
-	},
-	{
-		KEY_J,
-		KEY_L,
-		KEY_I,
-		KEY_K,
-		KEY_U,
-		KEY_ESCAPE,
-	},
-	{
-		KEY_KP_4,
-		KEY_KP_6,
-		KEY_KP_8,
-		KEY_KP_5,
-		KEY_KP_7,
-		KEY_ESCAPE,
-	},
-};
-
 static void virtual_input_init(Virtual_Input *input) {
 	for (int device_index = 0; device_index < NUM_INPUT_DEVICES; ++device_index) {
 		Virtual_Input_Device *dev = &input->devices[device_index];
@@ -741,48 +667,22 @@ static void game_init(Game_State *game_state) {
 	Virtual_Input *input = &game_state->input;
 	virtual_input_init(input);
 
-	// Init player parameters
-	{
-		Player_Parameters *params;
-
-		params = &game_state->players[0].params;
-
-		*params = (Player_Parameters){0};
-		params->input_device = &input->devices[0];
-		params->key_text = "Arrow Keys + Right CTRL";
-		params->sound_pop = LoadSound("resources/player_1_pop.wav");
-		params->sound_hit = LoadSound("resources/player_1_hit.wav");
-		params->color = (Color){240.0f, 120.0f, 0.0f, 255.0f};
-
-		params = &game_state->players[1].params;
-
-		*params = (Player_Parameters){0};
-		params->input_device = &input->devices[1];
-		params->key_text = "W,A,S,D + Left CTRL";
-		params->sound_pop = LoadSound("resources/player_2_pop.wav");
-		params->sound_hit = LoadSound("resources/player_2_hit.wav");
-		params->color = (Color){0.0f, 120.0f, 240.0f, 255.0f};
-
-		params = &game_state->players[2].params;
-
-		*params = (Player_Parameters){0};
-		params->input_device = &input->devices[2];
-		params->key_text = "I,J,K,L + U";
-		params->sound_pop = LoadSound("resources/player_2_pop.wav");
-		params->sound_hit = LoadSound("resources/player_2_hit.wav");
-		params->color = (Color){40.0f, 220.0f, 80.0f, 255.0f};
-
-		params = &game_state->players[3].params;
-
-		*params = (Player_Parameters){0};
-		params->input_device = &input->devices[3];
-		params->key_text = "Num 8,4,5,6 + Num 7";
-		params->sound_pop = LoadSound("resources/player_1_pop.wav");
-		params->sound_hit = LoadSound("resources/player_1_hit.wav");
-		params->color = (Color){180.0f, 50.0f, 220.0f, 255.0f};
-	}
+	sim_init(&game_state->sim, 0);
+	game_params_for_new_game = sim_default_params;
+
+	// NOTE(jakob): Player sounds are made from these when the players are
+	// created in game_reset
+	game_state->wave_pop[0] = LoadWave("resources/player_1_pop.wav");
+	game_state->wave_hit[0] = LoadWave("resources/player_1_hit.wav");
+	game_state->wave_pop[1] = LoadWave("resources/player_2_pop.wav");
+	game_state->wave_hit[1] = LoadWave("resources/player_2_hit.wav");
 	game_state->sound_win = LoadSound("resources/win.wav");
 
+	// NOTE(jakob): Baked once; the "Obstacles" setting decides whether a match uses them
+	obstacle_field_load(&game_state->sim.obstacles, "resources/obstacles.txt");
+
+	sim_events_add_consumer(&game_state->sim.events, game_present_sim_events, game_state);
+
 	game_state->color_red = 255;
 	game_state->color_green = 255;
 	game_state->color_blue = 255;
@@ -795,7 +695,7 @@ static void game_init(Game_State *game_state) {
 		long t = time(NULL);
 		random_state ^= (t*13) ^ (t>>4);
 	}
-	game_state->random_state = random_state;
+	game_state->sim.random_state = random_state;
 
 #if 1
 	{
@@ -825,7 +725,7 @@ static void game_init(Game_State *game_state) {
 
 static void game_update(Game_State *game_state, float dt) {
 
-	Game_Parameters *game_params = &game_state->params;
+	Game_Parameters *game_params = &game_state->sim.params;
 	
 	dt *= game_state->time_scale;
 	game_state->game_play_time += dt;
@@ -862,398 +762,33 @@ static void game_update(Game_State *game_state, float dt) {
 		dt *= slow_motion_factor;
 	}
 
-	for (int player_index = 0; player_index < game_params->num_players; ++player_index) {
-		Player *player = &game_state->players[player_index];
+	Entity_Query players = entity_query(&game_state->sim.entities, ENTITY_MASK(ENTITY_PLAYER), 0);
+	for (int player_index; (player_index = entity_query_next(&players)) >= 0;) {
+		Player_Presentation *presentation = &game_state->player_presentation[player_index];
 
-		if (player->health == 0 && player->death_animation_t < 1.0f) {
-			player->death_animation_t += dt;
+		if (presentation->hit_animation_t < 1.0f) {
+			presentation->hit_animation_t += dt*4.0f;
+		}
+
+		if (!entity_has(&game_state->sim.entities, player_index, ENTITY_ALIVE) && presentation->death_animation_t < 1.0f) {
+			presentation->death_animation_t += dt;
 		}
 	}
 
 	// Update Rings
-	for (int ring_index = 0; ring_index < game_state->active_rings; ) {
+	Entity_Query rings = entity_query(&game_state->ring_entities, ENTITY_MASK(ENTITY_RING), 0);
+	for (int ring_index; (ring_index = entity_query_next(&rings)) >= 0;) {
 
 		Ring *ring = &game_state->rings[ring_index];
 
 		ring->t += dt * 2.5f;
 
 		if (ring->t > 1.0f) {
-			game_state->rings[ring_index] = game_state->rings[--game_state->active_rings];
-		}
-		else {
-			++ring_index;
-		}
-	}
-
-}
-
-static void game_update_fixed(Game_State *game_state) {
-
-	const float dt = TIME_STEP_FIXED;
-	Game_Parameters *game_params = &game_state->params;
-
-	// Update player motion
-	for (int player_index = 0; player_index < game_params->num_players; ++player_index) {
-
-		Player *player = &game_state->players[player_index];
-		if (player->health <= 0) continue;
-
-
-		Virtual_Input_Device_State input = player->params.input_device->state;
-		Vector2 control = input.direction;
-
-		float friction_fraction = 1.0f;
-
-		if (control.x == 0.0f && control.y == 0.0f) {
-			friction_fraction = 0.1f;
-		}
-		else {
-
-			float control_angle = atan2f(control.y, control.x);
-
-			// Normalize player movement controls
-			control = Vector2NormalizeOrZero(control);
-
-			float old_angle = player->shoot_angle;
-			player->shoot_angle = lerp_angle(player->shoot_angle, control_angle, 3.0f * dt);
-
-			float angular_pulse = 10.0f*shortest_angle_difference(old_angle, player->shoot_angle);
-
-			player->angular_velocity = 0.5f*player->angular_velocity + 0.5f*angular_pulse;
-
-		}
-
-		Vector2 acceleration = Vector2Scale(control, game_params->acceleration_force * dt);
-
-		acceleration = Vector2Subtract(acceleration, Vector2Scale(player->velocity, game_params->friction * friction_fraction * dt));
-
-		//
-		// Shooting:
-		//
-		if (player->shoot_time_out < game_state->game_play_time) {
-
-			if (input.buttons[VIRTUAL_BUTTON_ACTION].is_down && player->shoot_charge_t < 1.0f) {
-				float full_charges_per_second = game_params->full_charges_per_second;
-
-				player->shoot_charge_t += full_charges_per_second * dt;
-				if (player->shoot_charge_t > 1.0f) {
-					player->shoot_charge_t = 1.0f;
-				}
-			}
-			else if (input.buttons[VIRTUAL_BUTTON_ACTION].is_released) {
-				float shoot_cooldown_seconds = 1.0f;
-				player->shoot_time_out = game_state->game_play_time + shoot_cooldown_seconds;
-
-				float comeback_factor = calculate_player_comeback_factor(player, game_params);
-				float speed = 50.0f + (400.0f + comeback_factor*650.0f)*player->shoot_charge_t;
-
-				Vector2 shoot_vector = (Vector2){cosf(player->shoot_angle), sinf(player->shoot_angle)};
-
-				float recoil_factor = Vector2DotProduct(shoot_vector, Vector2NormalizeOrZero(player->velocity));
-
-				if (recoil_factor < 0) {
-					recoil_factor = 0;
-				}
-
-				float angle_span;
-				int bullet_count;
-				calculate_bullet_count_and_angle_span(player, game_params, &bullet_count, &angle_span);
-
-				spawn_bullet_fan(player, game_params, bullet_count, speed, angle_span);
-
-				acceleration = Vector2Subtract(acceleration, Vector2Scale(shoot_vector, speed*recoil_factor));
-
-				player->shoot_charge_t = 0.0f;
-			}
-		}
-
-		player->velocity = Vector2Add(player->velocity, acceleration);
-	}
-
-	// Player collision detection and response
-	//
-	for (int collision_iteration = 0; collision_iteration < 8; ++collision_iteration) {
-
-		float cumulative_collision_overlap = 0;
-
-		for (int player_1_index = 0; player_1_index < game_params->num_players; ++player_1_index) {
-			for (int player_2_index = player_1_index + 1; player_2_index < game_params->num_players; ++player_2_index) {
-
-				Player *player1 = game_state->players + player_1_index;
-				Player *player2 = game_state->players + player_2_index;
-				if (player1->health <= 0) continue;
-				if (player2->health <= 0) continue;
-
-				Vector2 player1_to_position = Vector2Add(player1->position, Vector2Scale(player1->velocity, dt));
-				Vector2 player2_to_position = Vector2Add(player2->position, Vector2Scale(player2->velocity, dt));
-
-				float player1_radius = calculate_player_radius(player1, game_params);
-				float player2_radius = calculate_player_radius(player2, game_params);
-
-				float radii_sum = player2_radius + player1_radius;
-
-				Vector2 position_difference = Vector2Subtract(player2_to_position, player1_to_position);
-				float distance = Vector2Length(position_difference);
-
-				if (distance <= radii_sum) {
-
-
-					// Static collision
-					float half_overlap = 0.5f*(distance - radii_sum);
-
-					float inv_distance = 1.0f/distance;
-					
-					cumulative_collision_overlap += 2.0f*half_overlap*inv_distance;
-
-					player1->position = player1_to_position = Vector2Add(player1_to_position, Vector2Scale(position_difference, half_overlap*inv_distance));
-					player2->position = player2_to_position = Vector2Add(player2_to_position, Vector2Scale(position_difference, -half_overlap*inv_distance));
-
-					// Dynamic collision
-					// assert(fabs(radii_sum - Vector2Length(position_difference)) < 0.0001f);
-					distance = radii_sum;//Vector2Length(position_difference);; // After the move, the distance is exactly equal to the sum of radii
-					inv_distance = 1.0f/distance; // After the move, the distance is exactly equal to the sum of radii
-					position_difference = Vector2Subtract(player2_to_position, player1_to_position);
-
-					Vector2 normal = Vector2Scale(position_difference, inv_distance);
-					Vector2 tangent = (Vector2){normal.y, -normal.x};
-
-					float normal_response_1 = Vector2DotProduct(normal, player1->velocity);
-					float normal_response_2 = Vector2DotProduct(normal, player2->velocity);
-
-					float tangental_response_1 = Vector2DotProduct(tangent, player1->velocity);
-					float tangental_response_2 = Vector2DotProduct(tangent, player2->velocity);
-
-					float mass_1 = calculate_player_radius(player1, game_params);
-					float mass_2 = calculate_player_radius(player2, game_params);
-
-					float momentum_1 = (normal_response_1 * (mass_1 - mass_2) + 2.0f * mass_2 * normal_response_2) / (mass_1 + mass_2);
-					float momentum_2 = (normal_response_2 * (mass_2 - mass_1) + 2.0f * mass_1 * normal_response_1) / (mass_1 + mass_2);
-
-					player1->velocity = Vector2Add(
-						Vector2Scale(tangent, tangental_response_1),
-						Vector2Scale(normal, momentum_1)
-					);
-
-					player2->velocity = Vector2Add(
-						Vector2Scale(tangent, tangental_response_2),
-						Vector2Scale(normal, momentum_2)
-					);
-
-					if (hit_is_hard_enough(normal_response_1)) {
-						spawn_bullet_ring(player1, game_state);
-					}
-
-					if (hit_is_hard_enough(normal_response_2)) {
-						spawn_bullet_ring(player2, game_state);
-					}
-				}
-			}
-		}
-
-		if (cumulative_collision_overlap < 0.0001f) {
-			// printf("cumulative_collision_overlap: %.4f\n", cumulative_collision_overlap);
-			break;
-		}
-	}
-
-	for (int player_index = 0; player_index < game_params->num_players; ++player_index) {
-
-		Player *player = game_state->players + player_index;
-		if (player->health <= 0) continue;
-
-		float player_radius = calculate_player_radius(player, game_params);
-
-		Vector2 target_position = player->position = Vector2Add(
-			player->position,
-			Vector2Scale(player->velocity, dt)
-		);
-
-		// Bounce on view edges
-		{
-			float bounce_back_factor = -0.6f;
-			float edge_offset;
-
-			float cumulative_edge_bounce = 0.0f;
-
-			View view = game_state->view;
-
-			if (player->velocity.x > 0) {
-				edge_offset = view.width - (target_position.x + player_radius);
-
-				if (edge_offset < 0) {
-					target_position.x = view.width - player_radius;
-
-					cumulative_edge_bounce += fabs(player->velocity.x);
-
-					player->velocity.x = bounce_back_factor*(player->velocity.x + edge_offset);
-				}
-			}
-			else {
-				edge_offset = (target_position.x - player_radius) - 0;
-
-				if (edge_offset < 0) {
-					target_position.x = 0 + player_radius;
-
-					cumulative_edge_bounce += fabs(player->velocity.x);
-
-					player->velocity.x = bounce_back_factor*(player->velocity.x + edge_offset);
-				}
-			}
-
-			if (player->velocity.y > 0) {
-
-				edge_offset = view.height - (target_position.y + player_radius);
-
-				if (edge_offset < 0) {
-					target_position.y = view.height - player_radius;
-
-					cumulative_edge_bounce += fabs(player->velocity.y);
-
-					player->velocity.y = bounce_back_factor*(player->velocity.y + edge_offset);
-
-				}
-			}
-			else {
-				edge_offset = (target_position.y - player_radius) - 0;
-
-				if (edge_offset < 0) {
-					target_position.y = 0 + player_radius;
-
-					cumulative_edge_bounce += fabs(player->velocity.y);
-
-					player->velocity.y = bounce_back_factor*(player->velocity.y + edge_offset);
-				}
-			}
-
-			if (hit_is_hard_enough(cumulative_edge_bounce)) {
-				spawn_bullet_ring(player, game_state);
-			}
-		}
-
-		player->position = target_position;
-
-		float speed = Vector2Length(player->velocity);
-
-		float comeback_energy = calculate_player_comeback_factor(player, game_params);
-		player->energy += dt * (speed * (1 + comeback_energy)) / (player->energy*2.0f + 1.0f);
-
-		if (player->hit_animation_t < 1.0f) {
-			player->hit_animation_t += dt*4.0f;
-		}
-
-		if (game_state->title_alpha > 0) {
-			game_state->title_alpha -= Vector2Length(player->velocity)*0.0001f;
+			entity_remove(&game_state->ring_entities, ring_index, ENTITY_RING);
 		}
 	}
 
-	View view = game_state->view;
-
-	// Update bullets
-	for (int player_index = 0; player_index < game_params->num_players; ++player_index) {
-		Player *player = game_state->players + player_index;
-		for (int bullet_index = 0; bullet_index < player->active_bullets; ++bullet_index) {
-
-			Bullet *bullet = &player->bullets[bullet_index];
-
-			bullet->time += dt;
-			if (bullet->time > game_params->bullet_time_end_fade) {
-				player->bullets[bullet_index--] = player->bullets[--player->active_bullets];
-				continue;
-			}
-
-			Vector2 bullet_position = bullet->position;
-
-			bullet->position = Vector2Add(bullet_position, Vector2Scale(bullet->velocity, dt));
-
-			if (position_outside_playzone(bullet->position, view)) {
-				player->bullets[bullet_index--] = player->bullets[--player->active_bullets];
-				continue;
-			}
-
-			// This enables spin moves
-			bullet->velocity = Vector2Rotate(bullet->velocity, dt*bullet->spin);
-
-			float bullet_radius = game_params->bullet_radius;
-			bool destroy_bullet = false;
-
-			for (int opponent_index = 0; opponent_index < game_params->num_players; ++opponent_index) {
-				if (opponent_index == player_index) continue;
-
-				Player *opponent = game_state->players + opponent_index;
-				if (opponent->health <= 0) continue;
-
-				float opponent_radius = calculate_player_radius(opponent, game_params);
-				bool bullet_overlaps_opponent = CheckCollisionCircles(bullet_position, bullet_radius, opponent->position, opponent_radius);
-
-				if (bullet_overlaps_opponent) {
-					destroy_bullet = true;
-					// If bullet overlaps opponent player, subtract health and (defer) remove bullet from pool
-
-					--opponent->health;
-
-					Vector2 diff = Vector2Subtract(bullet_position, opponent->position);
-
-					diff = Vector2NormalizeOrZero(diff);
-
-					float bullet_mass = 0.125f;
-					float bullet_speed = Vector2Length(bullet->velocity);
-
-					opponent->velocity = Vector2Subtract(opponent->velocity, Vector2Scale(diff, bullet_mass*bullet_speed));
-
-					float ring_angle = atan2f(diff.x, diff.y)*(180.0f/PI);
-
-					PlaySound(opponent->params.sound_hit);
-					spawn_ring(game_state, bullet_position, player_index, ring_angle);
-
-					opponent->hit_animation_t = 0.0f;
-
-					if (opponent->health <= 0) {
-
-						float bullet_speed = 8 + (2*(opponent->energy/game_params->bullet_energy_cost_ring));
-
-						spawn_bullet_ring_ex(
-							opponent,
-							game_state,
-							bullet_speed,
-							200.0f + 10.0f*opponent->energy,
-							bullet_speed * 0.025f
-						);
-
-						opponent->death_animation_t = 0.0f;
-
-						// Game ends
-
-						if (game_state->triumphant_player == -1) {
-							++game_state->num_dead_players;
-
-							if (is_game_over(game_state)) {
-
-								int triumphant_player = 0;
-
-								while (triumphant_player < game_params->num_players) {
-									if (game_state->players[triumphant_player].health > 0) break;
-									++triumphant_player;
-								}
-
-								game_state->triumphant_player = triumphant_player;
-								game_state->time_scale = 0.25f;
-								PlaySound(game_state->sound_win);
-							}
-							else {
-								// Start dramatic slow motion
-								game_state->slow_motion_t = 0.0f;
-							}
-						}
-
-					}
-				}
-			}
-
-			if (destroy_bullet) {
-				player->bullets[bullet_index--] = player->bullets[--player->active_bullets];
-			}
-		}
-	}
+	game_update_camera(game_state, 1.0f - expf(-4.0f*dt));
 }
 
 
@@ -1303,12 +838,24 @@ static void game_update_menu(Game_State *game_state, float dt) {
 				int *value = item->u.range.int_range.value;
 				int min = item->u.range.int_range.min;
 				int max = item->u.range.int_range.max;
-				*value += item_change_x;
-				if (*value < min) {
-					*value = max;
+				int doubling_from = item->u.range.int_range.doubling_from;
+				if (doubling_from > 0) {
+					if (item_change_x > 0) {
+						*value = *value < doubling_from ? *value + 1 : 2*(*value);
+					}
+					else {
+						*value = *value > doubling_from ? MAXIMUM(doubling_from, *value/2) : *value - 1;
+					}
+					*value = MINIMUM(MAXIMUM(*value, min), max);
 				}
-				else if (*value > max) {
-					*value = min;
+				else {
+					*value += item_change_x;
+					if (*value < min) {
+						*value = max;
+					}
+					else if (*value > max) {
+						*value = min;
+					}
 				}
 			}
 			break;
@@ -1396,48 +943,11 @@ static void game_update_menu(Game_State *game_state, float dt) {
 
 }
 
-static void game_constrain_players_to_view(Game_State *game_state) {
-	Game_Parameters *game_params = &game_state->params;
-
-	for (int player_index = 0; player_index < game_params->num_players; ++player_index) {
-
-		Player *player = game_state->players + player_index;
-		if (player->health <= 0) continue;
-
-		float radius = calculate_player_radius(player, game_params);
-
-		View view = game_state->view;
-
-		Rectangle view_rectangle = {0, 0, view.width, view.height};
-
-		if (!CheckCollisionPointRec(player->position, view_rectangle)) {
-
-			Vector2 min_corner = Vector2SubtractValue(player->position, radius);
-			Vector2 max_corner = Vector2AddValue(player->position, radius);
-
-			if (min_corner.x < 0) {
-				player->position.x = radius;
-			}
-			else if (max_corner.x > view.width) {
-				player->position.x = view.width - radius;
-			}
-
-			if (min_corner.y < 0) {
-				player->position.y = radius;
-			}
-			else if (max_corner.y > view.height) {
-				player->position.y = view.height - radius;
-			}
-
-		}
-	}
-}
-
 static void game_draw(Game_State *game_state) {
 
 	float step_t = game_state->time_step_t;
 
-	Game_Parameters *game_params = &game_state->params;
+	Game_Parameters *game_params = &game_state->sim.params;
 	Font default_font = GetFontDefault();
 
 	BeginDrawing();
@@ -1485,26 +995,61 @@ static void game_draw(Game_State *game_state) {
 	}
 
 	//
-	// Draw player death animations
+	// Draw obstacles
 	//
-	for (int player_index = 0; player_index < game_params->num_players; ++player_index) {
-		Player *player = game_state->players + player_index;
-		if (player->health == 0 && player->death_animation_t < 1.0f) {
-			float t = player->death_animation_t;
+	if (game_params->obstacles) {
+		Obstacle_Field *obstacles = &game_state->sim.obstacles;
+		Color obstacle_color = (Color){96, 96, 96, 255};
+
+		for (int shape_index = 0; shape_index < obstacles->shape_count; ++shape_index) {
+			Obstacle_Shape *shape = &obstacles->shapes[shape_index];
+			Vector2 a = world_to_screen(game_state, shape->a);
+			Vector2 b = world_to_screen(game_state, shape->b);
+			float thickness = shape->thickness*view.scale;
+
+			switch (shape->type) {
+				case OBSTACLE_CIRCLE: {
+					DrawCircleV(a, thickness, obstacle_color);
+				} break;
+				case OBSTACLE_BOX: {
+					Vector2 corner = (Vector2){MINIMUM(a.x, b.x), MINIMUM(a.y, b.y)};
+					DrawRectangleV(corner, Vector2Abs(Vector2Subtract(b, a)), obstacle_color);
+				} break;
+				case OBSTACLE_WALL: {
+					DrawLineEx(a, b, 2.0f*thickness, obstacle_color);
+					DrawCircleV(a, thickness, obstacle_color);
+					DrawCircleV(b, thickness, obstacle_color);
+				} break;
+			}
+		}
+	}
 
-			Color ring_color = player->params.color;
+	//
+	// Draw player death animations
+	//
+	Entity_Query dead = entity_query(&game_state->sim.entities, ENTITY_MASK(ENTITY_PLAYER), ENTITY_MASK(ENTITY_ALIVE));
+	for (int player_index; (player_index = entity_query_next(&dead)) >= 0;) {
+		Player *player = game_state->sim.players + player_index;
+		Player_Presentation *presentation = &game_state->player_presentation[player_index];
+		if (presentation->death_animation_t < 1.0f) {
+			float t = presentation->death_animation_t;
+
+			Color ring_color = game_state->player_params[player_index].color;
 			ring_color.a = 64;
 
 			float t1 = 1.0f - t;
 			float t2 = t;
 			t1 = 1.0f - t1*t1;
 
-			float ring_radius = 0.5f*(view.width + view.height)*view.scale;
+			float ring_radius = 0.5f*(view.width + view.height);
+			if (!world_circle_visible(game_state, player->position, t1*ring_radius)) continue;
+
+			ring_radius *= view.scale;
 
 			float outer_radius = t1*ring_radius;
 			float inner_radius = t2*ring_radius;
 
-			Vector2 pos = Vector2Scale(player->position, view.scale);
+			Vector2 pos = world_to_screen(game_state, player->position);
 
 			DrawRing(pos, inner_radius, outer_radius, 0, 360, 60, ring_color);
 		}
@@ -1513,21 +1058,47 @@ static void game_draw(Game_State *game_state) {
 	//
 	// Draw player's bullets
 	//
-	for (int player_index = 0; player_index < game_params->num_players; ++player_index) {
+	Bullet_Pool *bullets = &game_state->sim.bullets;
+
+	for (int volley_index = 0; volley_index < bullets->active_volleys; ++volley_index) {
 
-		Player *player = game_state->players + player_index;
+		Bullet_Volley *volley = &bullets->volleys[volley_index];
+		Player_Parameters *parameters = &game_state->player_params[volley->owner];
 
-		Player_Parameters *parameters = &player->params;
+		// NOTE(jakob): Cull whole volleys first; in a large arena most are off
+		// screen. The margin covers the interpolation step and the tail.
+		float volley_speed = volley->speed + Vector2Length((Vector2){volley->base_vx, volley->base_vy});
+		float bullet_margin = game_params->bullet_radius + (0.2f + TIME_STEP_FIXED)*volley_speed;
+		float volley_reach = bullet_pool_volley_reach(bullets, volley_index, game_state->sim.tick_count + 1);
+		if (!world_circle_visible(game_state, (Vector2){volley->x, volley->y}, volley_reach + bullet_margin)) continue;
 
-		for (int bullet_index = 0; bullet_index < player->active_bullets; ++bullet_index) {
+		float bullet_time = bullet_pool_age(bullets, volley_index, game_state->sim.tick_count);
 
-			Bullet *bullet = &player->bullets[bullet_index];
+		// NOTE(jakob): Expired volleys stay in the pool until the next bullet
+		// window starts
+		if (bullet_time >= game_params->bullet_time_end_fade) continue;
 
-			float s = bullet->time < 0.3f ? bullet->time/0.3f : 1.0f;
+		float s = bullet_time < 0.3f ? bullet_time/0.3f : 1.0f;
 
-			Vector2 bullet_pos = interpolate_movement(bullet->position, bullet->velocity, step_t);
+		float t = 1.0f;
 
-			Vector2 direction = Vector2Scale(bullet->velocity, -0.2f*s);
+		if (bullet_time >= game_params->bullet_time_begin_fade) {
+			t = (bullet_time - game_params->bullet_time_begin_fade)/(game_params->bullet_time_end_fade - game_params->bullet_time_begin_fade);
+			t *= t*t;
+			t = 1.0f - t;
+		}
+
+		const uint64_t *alive_words = bullet_pool_alive_words(bullets, volley_index);
+
+		for (int lane = -1; (lane = bits_next(alive_words, volley->count, lane + 1)) >= 0;) {
+
+			Vector2 bullet_state_pos, bullet_velocity;
+			bullet_pool_state(bullets, volley_index, lane, game_state->sim.tick_count, &bullet_state_pos, &bullet_velocity);
+			Vector2 bullet_pos = interpolate_movement(bullet_state_pos, bullet_velocity, step_t);
+
+			if (!world_circle_visible(game_state, bullet_pos, bullet_margin)) continue;
+
+			Vector2 direction = Vector2Scale(bullet_velocity, -0.2f*s);
 			Vector2 point_tail = Vector2Add(bullet_pos, direction);
 			Vector2 tail_to_position_difference = Vector2Subtract(bullet_pos, point_tail);
 
@@ -1535,14 +1106,6 @@ static void game_draw(Game_State *game_state) {
 
 			Vector2 mid_point = Vector2Add(point_tail, Vector2Scale(tail_to_position_difference, 0.5f));
 
-			float t = 1.0f;
-
-			if (bullet->time >= game_params->bullet_time_begin_fade) {
-				t = (bullet->time - game_params->bullet_time_begin_fade)/(game_params->bullet_time_end_fade - game_params->bullet_time_begin_fade);
-				t *= t*t;
-				t = 1.0f - t;
-			}
-
 			Circle mid_circle = {mid_point, mid_circle_radius};
 
 			float bullet_radius = game_params->bullet_radius;
@@ -1556,32 +1119,36 @@ static void game_draw(Game_State *game_state) {
 			if (result.are_intersecting) {
 				Color tail_color = parameters->color;
 				tail_color.a = 32;
-				DrawTriangle(Vector2Scale(point_tail, view.scale), Vector2Scale(result.intersection_points[0], view.scale), Vector2Scale(result.intersection_points[1], view.scale), tail_color);
+				DrawTriangle(world_to_screen(game_state, point_tail), world_to_screen(game_state, result.intersection_points[0]), world_to_screen(game_state, result.intersection_points[1]), tail_color);
 			}
 
-			Vector2 bullet_screen_position = Vector2Scale(bullet_pos, view.scale);
+			Vector2 bullet_screen_position = world_to_screen(game_state, bullet_pos);
 			DrawCircleV(bullet_screen_position, bullet_radius*bullet_scale, parameters->color);
-
 		}
 	}
 
 	//
 	// Draw players
 	//
-	for (int player_index = 0; player_index < game_params->num_players; ++player_index) {
+	Entity_Query living = entity_query(&game_state->sim.entities, ENTITY_MASK(ENTITY_ALIVE), 0);
+	for (int player_index; (player_index = entity_query_next(&living)) >= 0;) {
 
-		Player *player = game_state->players + player_index;
-		if (player->health <= 0) continue;
+		Player *player = game_state->sim.players + player_index;
 
-		Player_Parameters *parameters = &player->params;
+		Player_Parameters *parameters = &game_state->player_params[player_index];
+		Player_Presentation *presentation = &game_state->player_presentation[player_index];
 
 		float player_radius = calculate_player_radius(player, game_params);
 		float player_radius_screen = player_radius*view.scale;
 		float font_size = player_radius_screen*1.0f;
 		float font_spacing = font_size*FONT_SPACING_FOR_SIZE;
 
-		Vector2 player_position_screen = interpolate_movement(player->position, player->velocity, step_t);
-		player_position_screen = Vector2Scale(player_position_screen, view.scale);
+		Vector2 player_position = interpolate_movement(player->position, player->velocity, step_t);
+
+		// The arrows reach up to 50 past the body
+		if (!world_circle_visible(game_state, player_position, player_radius + 50.0f)) continue;
+
+		Vector2 player_position_screen = world_to_screen(game_state, player_position);
 		
 		// Draw player's body
 		DrawCircleV(player_position_screen, player_radius_screen, parameters->color);
@@ -1652,9 +1219,9 @@ static void game_draw(Game_State *game_state) {
 		{
 			const char *health_text_string = TextFormat("%i", player->health);
 
-			float t = player->hit_animation_t;
+			float t = presentation->hit_animation_t;
 			if (t < 1.0f) {
-				float font_size_factor = 1 + 0.5f * sinf(PI*player->hit_animation_t);
+				float font_size_factor = 1 + 0.5f * sinf(PI*presentation->hit_animation_t);
 				font_size *= font_size_factor;
 				font_spacing = font_size*FONT_SPACING_FOR_SIZE;
 			}
@@ -1672,19 +1239,21 @@ static void game_draw(Game_State *game_state) {
 	// Draw explosion rings
 	//
 
-	for (int ring_index = 0; ring_index < game_state->active_rings; ++ring_index) {
+	Entity_Query rings = entity_query(&game_state->ring_entities, ENTITY_MASK(ENTITY_RING), 0);
+	for (int ring_index; (ring_index = entity_query_next(&rings)) >= 0;) {
 
 		Ring ring = game_state->rings[ring_index];
 
-		Player *player = &game_state->players[ring.player_index];
-
-		Color ring_color = player->params.color;
+		Color ring_color = game_state->player_params[ring.player_index].color;
 
 		float t1 = 1.0f - ring.t;
 		float t2 = ring.t;
 		t1 = 1.0f - t1*t1;
 
-		float ring_radius = 5.0f*game_params->bullet_radius*view.scale;
+		float ring_radius = 5.0f*game_params->bullet_radius;
+		if (!world_circle_visible(game_state, ring.position, ring_radius)) continue;
+
+		ring_radius *= view.scale;
 
 		float outer_radius = t1*ring_radius;
 		float inner_radius = t2*ring_radius;
@@ -1692,7 +1261,7 @@ static void game_draw(Game_State *game_state) {
 		float start_angle = ring.angle - 60.0;
 		float end_angle = ring.angle + 60.0f;
 
-		ring.position = Vector2Scale(ring.position, view.scale);
+		ring.position = world_to_screen(game_state, ring.position);
 
 		DrawRing(ring.position, inner_radius, outer_radius, start_angle, end_angle, 20, ring_color);
 	}
@@ -1701,20 +1270,24 @@ static void game_draw(Game_State *game_state) {
 	// Draw player controls
 	//
 
-	for (int player_index = 0; player_index < game_params->num_players; ++player_index) {
-		Player *player = game_state->players + player_index;
-		if (player->health <= 0) continue;
+	living = entity_query(&game_state->sim.entities, ENTITY_MASK(ENTITY_ALIVE), 0);
+	for (int player_index; (player_index = entity_query_next(&living)) >= 0;) {
+		Player *player = game_state->sim.players + player_index;
 
-		Player_Parameters *parameters = &player->params;
+		Player_Parameters *parameters = &game_state->player_params[player_index];
+		Player_Presentation *presentation = &game_state->player_presentation[player_index];
 
-		Vector2 player_screen_position = Vector2Scale(player->position, view.scale);
+		Vector2 player_screen_position = world_to_screen(game_state, player->position);
 
 		float player_speed = Vector2Length(player->velocity);
 
 		float max_speed_while_drawing_control_text = 150.0f;
 
-		if (player_speed <= max_speed_while_drawing_control_text) {
-			if (player->controls_text_timeout < game_state->game_play_time) {
+		if (!parameters->key_text) {
+			// NOTE(jakob): Bots have no controls to show
+		}
+		else if (player_speed <= max_speed_while_drawing_control_text) {
+			if (presentation->controls_text_timeout < game_state->game_play_time) {
 
 				float player_radius = calculate_player_radius(player, game_params)*view.scale;
 				float font_size = player_radius*1.0f;
@@ -1737,11 +1310,11 @@ static void game_draw(Game_State *game_state) {
 			}
 		}
 		else {
-			player->controls_text_timeout = game_state->game_play_time + 5.0;
+			presentation->controls_text_timeout = game_state->game_play_time + 5.0;
 		}
 	}
 
-	int triumphant_player = game_state->triumphant_player;
+	int triumphant_player = game_state->sim.triumphant_player;
 
 	if (triumphant_player >= 0 || game_state->show_menu) {
 
@@ -1755,17 +1328,12 @@ static void game_draw(Game_State *game_state) {
 
 		if (!game_state->show_menu) {
 
-			Color win_box_color = game_state->players[triumphant_player].params.color;
+			Color win_box_color = game_state->player_params[triumphant_player].color;
 			win_box_color.a = 192;
 
 
 
-			const char *win_text = (const char *[]){
-				"Orange Player Wins",
-				"Blue Player Wins",
-				"Green Player Wins",
-				"Purple Player Wins",
-			}[triumphant_player];
+			const char *win_text = TextFormat("%s Wins", game_state->player_params[triumphant_player].name);
 
 			const char *reset_button_text = "Press [Esc] or [Menu] to Reset";
 
@@ -1862,6 +1430,41 @@ static void game_draw(Game_State *game_state) {
 
 #ifndef NDEBUG
 	DrawFPS(10, 10);
+	{
+		Collision_Stats *stats = &game_state->sim.collision_stats;
+		int bullet_checks = stats->bullet_checks + stats->bullet_checks_skipped;
+		DrawText(
+			TextFormat("Bullet tests: %d, skipped: %d; bullets asleep: %d/%d (%d%%); cancelled: %d in %d tests",
+				stats->bullet_pair_tests, stats->bullet_pair_tests_skipped,
+				stats->bullet_checks_skipped, bullet_checks,
+				bullet_checks > 0 ? 100*stats->bullet_checks_skipped/bullet_checks : 0,
+				stats->bullets_annihilated, stats->bullet_annihilation_tests),
+			10, 35, 20, DARKGRAY
+		);
+	}
+	{
+		Bullet_Pool *pool = &game_state->sim.bullets;
+		Bullet_Pool_Metrics *metrics = &pool->metrics;
+		DrawText(
+			TextFormat("Bullets: %d/%d in %d volleys (peak %d), %d/%d KB, %d grows, %d dropped",
+				pool->active_bullets, metrics->capacity, pool->active_volleys, metrics->peak_active_bullets,
+				(int)(metrics->bytes_reserved/1024), (int)(metrics->memory_budget/1024),
+				metrics->grow_count, metrics->dropped_bullets),
+			10, 60, 20, DARKGRAY
+		);
+	}
+	DrawText(
+		TextFormat("Contacts: %d in %d islands and %d colors, %d iterations, %d solves, %d skipped",
+			game_state->sim.collision_stats.player_contacts, game_state->sim.collision_stats.player_islands,
+			game_state->sim.collision_stats.player_contact_colors,
+			game_state->sim.collision_stats.player_solver_iterations, game_state->sim.collision_stats.player_contact_solves,
+			game_state->sim.collision_stats.player_contact_solves_skipped),
+		10, 85, 20, DARKGRAY
+	);
+	DrawText(
+		TextFormat("State: %016llx%s", (unsigned long long)sim_state_hash(&game_state->sim), sim_deterministic ? " (deterministic trig)" : ""),
+		10, 110, 20, DARKGRAY
+	);
 #endif
 
 #if 0
@@ -1960,10 +1563,10 @@ int main(void)
 
 	MENU_DEF(controls_menu,
 		{MENU_ITEM_MENU_BACK, "Back", .u = {0}},
-		{MENU_ITEM_BOOL, "Use Gamepad for Orange Player", .u.bool_ref = &game_state->players[0].params.input_device->use_gamepad},
-		{MENU_ITEM_BOOL, "Use Gamepad for Blue Player", .u.bool_ref = &game_state->players[1].params.input_device->use_gamepad},
-		{MENU_ITEM_BOOL, "Use Gamepad for Green Player", .u.bool_ref = &game_state->players[2].params.input_device->use_gamepad},
-		{MENU_ITEM_BOOL, "Use Gamepad for Purple Player", .u.bool_ref = &game_state->players[3].params.input_device->use_gamepad},
+		{MENU_ITEM_BOOL, "Use Gamepad for Orange Player", .u.bool_ref = &game_state->input.devices[0].use_gamepad},
+		{MENU_ITEM_BOOL, "Use Gamepad for Blue Player", .u.bool_ref = &game_state->input.devices[1].use_gamepad},
+		{MENU_ITEM_BOOL, "Use Gamepad for Green Player", .u.bool_ref = &game_state->input.devices[2].use_gamepad},
+		{MENU_ITEM_BOOL, "Use Gamepad for Purple Player", .u.bool_ref = &game_state->input.devices[3].use_gamepad},
 	);
 
 	MENU_DEF(gameplay_settings_menu,
@@ -1971,13 +1574,31 @@ int main(void)
 		{MENU_ITEM_INT_RANGE, "Number of Players", .u.range.int_range = {
 			.value = &game_params_for_new_game.num_players,
 			.min = 2,
-			.max = 4,
+			.max = MAX_LOBBY_PLAYERS,
+			.doubling_from = MAX_LOCAL_PLAYERS,
+		}},
+		{MENU_ITEM_INT_RANGE, "Local Players (Rest Are Bots)", .u.range.int_range = {
+			.value = &game_params_for_new_game.num_local_players,
+			.min = 0,
+			.max = MAX_LOCAL_PLAYERS,
 		}},
 		{MENU_ITEM_INT_RANGE, "Starting Player Health", .u.range.int_range = {
 			.value = &game_params_for_new_game.starting_health,
 			.min = 1,
 			.max = 999,
 		}},
+		{MENU_ITEM_BOOL, "Bullets Cancel Out", .u.bool_ref = &game_params_for_new_game.bullet_annihilation},
+		{MENU_ITEM_BOOL, "Obstacles", .u.bool_ref = &game_params_for_new_game.obstacles},
+		{MENU_ITEM_INT_RANGE, "Bullet Tick Divisor", .u.range.int_range = {
+			.value = &game_params_for_new_game.bullet_tick_divisor,
+			.min = 1,
+			.max = MAX_BULLET_TICK_DIVISOR,
+		}},
+		{MENU_ITEM_INT_RANGE, "Arena Size (Screens)", .u.range.int_range = {
+			.value = &arena_screens_for_new_game,
+			.min = 1,
+			.max = 10,
+		}},
 		{MENU_ITEM_FLOAT, "Time Scale", .u.float_ref = &game_state->time_scale},
 	);
 
@@ -2019,14 +1640,19 @@ int main(void)
 
 			if (window_resized) {
 				game_state->view = get_updated_view();
-				game_constrain_players_to_view(game_state);
+				sim_set_arena(&game_state->sim, game_arena_for_view(game_state, game_state->view));
+				game_update_camera(game_state, 1.0f);
 			}
 
 			virtual_input_update(input);
 
+			for (int device_index = 0; device_index < MAX_LOCAL_PLAYERS; ++device_index) {
+				game_state->sim.local_inputs[device_index] = input->devices[device_index].state;
+			}
+
 			// Menu button handling
 			//
-			if (is_game_over(game_state) && !game_state->show_menu && input->input_common.buttons[VIRTUAL_BUTTON_MENU].is_pressed) {
+			if (sim_is_game_over(&game_state->sim) && !game_state->show_menu && input->input_common.buttons[VIRTUAL_BUTTON_MENU].is_pressed) {
 				game_reset(game_state, game_state->view);
 
 				// NOTE(jakob): Since we are staying in the same frame, we we fake-unpress the menu button;
@@ -2058,7 +1684,8 @@ int main(void)
 
 			if (!game_state->show_menu) {
 				for (int i = 0; i < num_fixed_time_steps; ++i) {
-					game_update_fixed(game_state);
+					sim_update_fixed(&game_state->sim);
+					sim_events_dispatch(&game_state->sim);
 				}
 				game_update(game_state, dt);
 			}
@@ -2073,6 +1700,10 @@ int main(void)
 		game_draw(game_state);
 	}
 
+	sim_shutdown(&game_state->sim);
+	free(game_state->player_params);
+	free(game_state->player_presentation);
+
 	CloseAudioDevice();
 	CloseWindow(); // Close window and OpenGL context
 